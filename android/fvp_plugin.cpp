@@ -10,9 +10,9 @@
 #include <mdk/Player.h>
 #include <mdk/MediaInfo.h>
 #include <cassert>
-#include <unordered_map>
 #include <iostream>
 #include <sys/system_properties.h>
+#include "../lib/src/registry.h"
 
 using namespace std;
 
@@ -32,7 +32,7 @@ public:
 private:
 };
 
-static unordered_map<int64_t, shared_ptr<TexturePlayer>> players;
+static fvp::Registry<TexturePlayer> players;
 
 
 extern "C" {
@@ -61,8 +61,7 @@ JNIEXPORT void JNICALL
 Java_com_mediadevkit_fvp_FvpPlugin_nativeSetSurface(JNIEnv *env, jobject thiz, jlong player_handle,
                                                     jlong tex_id, jobject surface, jint w, jint h, jboolean tunnel) {
     if (!player_handle || !surface) {
-        if (auto it = players.find(tex_id); it != players.end()) {
-            auto& player = it->second;
+        if (auto player = players.take(tex_id)) {
             auto s = player->surface;
             if (player->directSurface) {
                 // Release the codec BEFORE the surface dies, or it wedges
@@ -74,7 +73,6 @@ Java_com_mediadevkit_fvp_FvpPlugin_nativeSetSurface(JNIEnv *env, jobject thiz, j
                 player->setDecoders(mdk::MediaType::Video, {});
             }
             player->updateNativeSurface(nullptr);
-            players.erase(it);
             if (s) {
                 env->DeleteGlobalRef(s);
             }
@@ -103,18 +101,17 @@ Java_com_mediadevkit_fvp_FvpPlugin_nativeSetSurface(JNIEnv *env, jobject thiz, j
     }
     player->width = w;
     player->height = h;
-    players[tex_id] = player;
+    players.set(tex_id, player);
 }
 
 extern "C"
 JNIEXPORT void JNICALL
 Java_com_mediadevkit_fvp_FvpPlugin_nativeSetSurfaceSize(JNIEnv *env, jobject thiz, jlong tex_id,
                                                         jint w, jint h) {
-    auto it = players.find(tex_id);
-    if (it == players.end()) {
+    auto player = players.get(tex_id);
+    if (!player) {
         return;
     }
-    auto& player = it->second;
     player->width = w;
     player->height = h;
     // Only the GL renderer draws at the surface size; with tunnel the decoder
@@ -157,8 +154,7 @@ MdkGetPlayerVid(int64_t tex_id)
 {
     if (tex_id < 0)
         return nullptr;
-    if (const auto it = players.find(tex_id); it != players.end()) {
-        const auto& player = it->second;
+    if (const auto player = players.get(tex_id)) {
         return player->vo_opaque;
     }
     return nullptr;
@@ -0,0 +1,407 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Benchmark lib/src/callbacks.cpp with fake mdk players and a fake dart isolate.
+// - events: events/s and latency from mdk callback to postCObject enqueue and to isolate delivery, bytes per message. array and ring modes
+// - status: the same for MediaStatus callbacks w/o reply, array and packed modes
+// - log: cost in logging threads and isolate messages of mdk logs, posted directly or in batches
+// - reply: round trip of MediaStatus and Prepared callbacks blocked until the isolate replies
+// Usage: fvp_callbacks_bench [-n events] [-r replies] [-json]
+#include "mdk/Player.h"
+#include "callbacks.h"
+#include "dart_api_types.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace chrono;
+
+static int64_t nowNs()
+{
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// message copied by postCObject like dart vm does. only fields used by the benchmark are kept
+struct Message {
+    int type;
+    int64_t seq; // event: error value, reply types: unused
+    int64_t enqueued;
+};
+
+// single isolate, port is ignored
+class FakeIsolate
+{
+public:
+    static FakeIsolate& instance() {
+        static FakeIsolate i;
+        return i;
+    }
+
+    static bool post(Dart_Port, Dart_CObject* msg) {
+        auto& self = instance();
+        const auto t = nowNs();
+        self.bytes += size(msg);
+        ++self.messages;
+        Message m{ .type = 0, .seq = 0, .enqueued = t };
+        if (msg->type == Dart_CObject_kTypedData) { // packed, decoded like dart
+            const auto data = msg->value.as_typed_data.values;
+            memcpy(&m.type, data, 4);
+            memcpy(&m.seq, data + 16, 8);
+        } else {
+            const auto values = msg->value.as_array.values;
+            m.type = (int)values[0]->value.as_int64;
+            m.seq = msg->value.as_array.length > 1 && values[1]->type == Dart_CObject_kInt64 ? values[1]->value.as_int64 : 0;
+        }
+        scoped_lock lock(self.mtx);
+        self.queue.push_back(m);
+        self.cv.notify_one();
+        return true;
+    }
+
+    // serialized size, every node is a Dart_CObject
+    static size_t size(const Dart_CObject* o) {
+        size_t n = sizeof(*o);
+        switch (o->type) {
+        case Dart_CObject_kString:
+            n += strlen(o->value.as_string) + 1;
+            break;
+        case Dart_CObject_kArray:
+            n += o->value.as_array.length * sizeof(void*);
+            for (intptr_t i = 0; i < o->value.as_array.length; ++i)
+                n += size(o->value.as_array.values[i]);
+            break;
+        case Dart_CObject_kTypedData:
+            n += o->value.as_typed_data.length;
+            break;
+        default:
+            break;
+        }
+        return n;
+    }
+
+    bool pop(Message& m, milliseconds timeout = seconds(5)) {
+        unique_lock lock(mtx);
+        if (!cv.wait_for(lock, timeout, [this]{ return !queue.empty(); }))
+            return false;
+        m = queue.front();
+        queue.pop_front();
+        return true;
+    }
+
+    void reset() {
+        bytes = 0;
+        messages = 0;
+    }
+
+    atomic<size_t> bytes = 0;
+    atomic<size_t> messages = 0;
+private:
+    mutex mtx;
+    condition_variable cv;
+    deque<Message> queue;
+};
+
+struct Stats {
+    double p50 = 0;
+    double p99 = 0;
+    double max = 0;
+};
+
+static Stats stats(vector<int64_t> ns)
+{
+    Stats s;
+    if (ns.empty())
+        return s;
+    sort(ns.begin(), ns.end());
+    s.p50 = ns[ns.size() / 2] / 1000.0;
+    s.p99 = ns[min(ns.size() - 1, ns.size() * 99 / 100)] / 1000.0;
+    s.max = ns.back() / 1000.0;
+    return s;
+}
+
+static void printLatency(bool json, const char* name, const Stats& s, bool last = false)
+{
+    if (json)
+        printf("\"%s_p50_us\":%.2f,\"%s_p99_us\":%.2f,\"%s_max_us\":%.2f%s", name, s.p50, name, s.p99, name, s.max, last ? "" : ",");
+    else
+        printf("  %-10s p50 %8.2f us, p99 %8.2f us, max %8.2f us\n", name, s.p50, s.p99, s.max);
+}
+
+// fire events in an mdk thread and receive them in the isolate thread
+static void benchEvents(int count, bool ring, bool json)
+{
+    const auto postCObject = reinterpret_cast<void*>(&FakeIsolate::post);
+    auto& isolate = FakeIsolate::instance();
+    isolate.reset();
+    mdkPlayerAPI api;
+    const auto handle = reinterpret_cast<int64_t>(&api);
+    MdkCallbacksRegisterPort(handle, postCObject, 1);
+    MdkCallbacksRegisterType(handle, 0, false);
+    CallbackRecord* records = nullptr;
+    const int capacity = 1024;
+    if (ring)
+        records = static_cast<CallbackRecord*>(MdkCallbacksEnableEventBatch(handle, capacity));
+
+    vector<int64_t> fired(count);
+    vector<int64_t> enqueue;
+    vector<int64_t> delivery;
+    enqueue.reserve(count);
+    delivery.reserve(count);
+    atomic<int> received = 0;
+    thread consumer([&]{
+        Message m;
+        int64_t read = 0;
+        while (received < count && isolate.pop(m)) {
+            const auto t = nowNs();
+            if (m.type == 0) {
+                enqueue.push_back(m.enqueued - fired[m.seq]);
+                delivery.push_back(t - fired[m.seq]);
+                ++received;
+                continue;
+            }
+            if (m.type != 9) // ring
+                continue;
+            while (true) {
+                const auto end = MdkCallbacksRingCommit(handle, read);
+                if (end == read)
+                    break;
+                for (; read < end; ++read) {
+                    const auto& r = records[read % capacity];
+                    delivery.push_back(nowNs() - fired[r.values[0]]);
+                    ++received;
+                }
+            }
+        }
+    });
+
+    mdk::MediaEvent e{};
+    e.category = "reader.buffering";
+    e.detail = "progress";
+    const auto t0 = nowNs();
+    for (int i = 0; i < count; ++i) {
+        e.error = i;
+        fired[i] = nowNs();
+        api.event(e);
+        if (ring && i % (capacity / 2) == capacity / 2 - 1) { // let the isolate catch up instead of measuring drops
+            while (received < i - capacity / 4)
+                this_thread::yield();
+        }
+    }
+    consumer.join();
+    const auto elapsed = (nowNs() - t0) / 1e9;
+    MdkCallbacksUnregisterPort(handle);
+
+    const auto name = ring ? "ring" : "array";
+    const auto bytesPerEvent = received ? double(isolate.bytes + (ring ? received * sizeof(CallbackRecord) : 0)) / received : 0;
+    if (json) {
+        printf("{\"bench\":\"events_%s\",\"events\":%d,\"received\":%d,\"events_per_s\":%.0f,\"messages\":%zu,\"bytes_per_event\":%.1f,", name, count, received.load(), received / elapsed, isolate.messages.load(), bytesPerEvent);
+        if (!ring)
+            printLatency(json, "enqueue", stats(enqueue));
+        printLatency(json, "delivery", stats(delivery), true);
+        printf("}\n");
+    } else {
+        printf("events(%s): %d/%d in %.3fs, %.0f events/s, %zu messages, %.1f bytes/event\n", name, received.load(), count, elapsed, received / elapsed, isolate.messages.load(), bytesPerEvent);
+        if (!ring)
+            printLatency(json, "enqueue", stats(enqueue));
+        printLatency(json, "delivery", stats(delivery));
+    }
+}
+
+// MediaStatus w/o reply, old value is the sequence number
+static void benchStatus(int count, bool packed, bool json)
+{
+    const auto postCObject = reinterpret_cast<void*>(&FakeIsolate::post);
+    auto& isolate = FakeIsolate::instance();
+    isolate.reset();
+    mdkPlayerAPI api;
+    const auto handle = reinterpret_cast<int64_t>(&api);
+    MdkCallbacksRegisterPort(handle, postCObject, 1);
+    MdkCallbacksRegisterType(handle, 2, false);
+    if (packed)
+        MdkCallbacksSetPacked(handle, 1 << 2);
+
+    vector<int64_t> fired(count);
+    vector<int64_t> enqueue;
+    vector<int64_t> delivery;
+    enqueue.reserve(count);
+    delivery.reserve(count);
+    thread consumer([&]{
+        Message m;
+        while ((int)delivery.size() < count && isolate.pop(m)) {
+            const auto t = nowNs();
+            if (m.type != 2)
+                continue;
+            enqueue.push_back(m.enqueued - fired[m.seq]);
+            delivery.push_back(t - fired[m.seq]);
+        }
+    });
+    const auto t0 = nowNs();
+    for (int i = 0; i < count; ++i) {
+        fired[i] = nowNs();
+        api.status(mdk::MediaStatus(i), mdk::MediaStatus(i + 1));
+    }
+    consumer.join();
+    const auto elapsed = (nowNs() - t0) / 1e9;
+    MdkCallbacksUnregisterPort(handle);
+
+    const auto name = packed ? "packed" : "array";
+    const int received = (int)delivery.size();
+    const auto bytesPerMessage = isolate.messages ? double(isolate.bytes) / isolate.messages : 0;
+    if (json) {
+        printf("{\"bench\":\"status_%s\",\"events\":%d,\"received\":%d,\"events_per_s\":%.0f,\"bytes_per_message\":%.1f,", name, count, received, received / elapsed, bytesPerMessage);
+        printLatency(json, "enqueue", stats(enqueue));
+        printLatency(json, "delivery", stats(delivery), true);
+        printf("}\n");
+    } else {
+        printf("status(%s): %d/%d in %.3fs, %.0f events/s, %.1f bytes/message\n", name, received, count, elapsed, received / elapsed, bytesPerMessage);
+        printLatency(json, "enqueue", stats(enqueue));
+        printLatency(json, "delivery", stats(delivery));
+    }
+}
+
+// several mdk threads log at the same time. log forwarding is global, so direct mode must run first
+static void benchLogs(int count, int intervalMs, bool json)
+{
+    const auto postCObject = reinterpret_cast<void*>(&FakeIsolate::post);
+    auto& isolate = FakeIsolate::instance();
+    MdkCallbacksRegisterType(0, 5, false);
+    MdkCallbacksRegisterPort(0, postCObject, 1);
+    MdkCallbacksSetLogForwarding(int(mdk::LogLevel::All), intervalMs, 1024);
+    isolate.reset();
+    const auto dropped0 = MdkCallbacksLogDropped();
+    constexpr int kThreads = 4;
+    atomic<int64_t> spent = 0;
+    vector<thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&]{
+            const auto t0 = nowNs();
+            for (int i = 0; i < count / kThreads; ++i)
+                mdk::logHandler()(mdk::LogLevel::Debug, "decoder: frame decoded, pts 12.345, 1920x1080");
+            spent += nowNs() - t0;
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+    if (intervalMs > 0)
+        this_thread::sleep_for(milliseconds(intervalMs * 3));
+    const auto dropped = MdkCallbacksLogDropped() - dropped0;
+    const auto name = intervalMs > 0 ? "batch" : "direct";
+    const auto nsPerLine = double(spent) / (count / kThreads * kThreads);
+    if (json)
+        printf("{\"bench\":\"log_%s\",\"lines\":%d,\"ns_per_line\":%.1f,\"messages\":%zu,\"dropped\":%lld}\n", name, count, nsPerLine, isolate.messages.load(), (long long)dropped);
+    else
+        printf("log(%s): %d lines from %d threads, %.1f ns/line in logging thread, %zu messages, %lld dropped\n", name, count, kThreads, nsPerLine, isolate.messages.load(), (long long)dropped);
+    // drop queued messages
+    Message m;
+    while (isolate.pop(m, milliseconds(0))) {}
+}
+
+// mdk thread blocks in callback until the isolate replies
+static void benchReplies(int count, bool json)
+{
+    const auto postCObject = reinterpret_cast<void*>(&FakeIsolate::post);
+    auto& isolate = FakeIsolate::instance();
+    isolate.reset();
+    mdkPlayerAPI api;
+    const auto handle = reinterpret_cast<int64_t>(&api);
+    MdkCallbacksRegisterPort(handle, postCObject, 1);
+    MdkCallbacksRegisterType(handle, 2, true);
+    MdkCallbacksRegisterType(handle, 3, true);
+    atomic<bool> done = false;
+    thread consumer([&]{
+        Message m;
+        while (!done) {
+            if (!isolate.pop(m, milliseconds(10)))
+                continue;
+            CallbackReply rep{};
+            if (m.type == 2)
+                rep.mediaStatus.ret = true;
+            else if (m.type == 3)
+                rep.prepared = { .ret = true, .boost = true };
+            else
+                continue;
+            MdkCallbacksReplyType(handle, m.type, &rep);
+        }
+    });
+
+    vector<int64_t> status;
+    vector<int64_t> prepared;
+    status.reserve(count);
+    prepared.reserve(count);
+    // not in the thread registered port, otherwise callbacks won't wait
+    thread([&]{
+        for (int i = 0; i < count; ++i) {
+            auto t = nowNs();
+            api.status(mdk::MediaStatus::Loading, mdk::MediaStatus::Loaded);
+            status.push_back(nowNs() - t);
+        }
+    }).join();
+    for (int i = 0; i < count; ++i) {
+        MdkPrepare(handle, 0, 0, postCObject, 1);
+        function<bool(int64_t, bool*)> cb;
+        while (!cb) { // prepare() is called in a worker
+            this_thread::yield();
+            scoped_lock lock(api.mtx);
+            cb = std::exchange(api.prepared, nullptr);
+        }
+        thread([&]{
+            bool boost = false;
+            const auto t = nowNs();
+            cb(0, &boost);
+            prepared.push_back(nowNs() - t);
+        }).join();
+    }
+    done = true;
+    consumer.join();
+    MdkCallbacksUnregisterPort(handle);
+
+    if (json) {
+        printf("{\"bench\":\"replies\",\"count\":%d,\"bytes_per_message\":%.1f,", count, isolate.messages ? double(isolate.bytes) / isolate.messages : 0);
+        printLatency(json, "status", stats(status));
+        printLatency(json, "prepared", stats(prepared), true);
+        printf("}\n");
+    } else {
+        printf("reply round trip: %d each, %.1f bytes/message\n", count, isolate.messages ? double(isolate.bytes) / isolate.messages : 0);
+        printLatency(json, "status", stats(status));
+        printLatency(json, "prepared", stats(prepared));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int events = 200000;
+    int replies = 2000;
+    bool json = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            events = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            replies = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-json")) {
+            json = true;
+        } else {
+            fprintf(stderr, "usage: %s [-n events] [-r replies] [-json]\n", argv[0]);
+            return 2;
+        }
+    }
+    benchEvents(events, false, json);
+    benchEvents(events, true, json);
+    benchStatus(events, false, json);
+    benchStatus(events, true, json);
+    benchReplies(replies, json);
+    benchLogs(events, 0, json);
+    benchLogs(events, 10, json);
+    return 0;
+}
@@ -0,0 +1,134 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Fake mdk api used by lib/src/callbacks.cpp, for benchmarks w/o mdk sdk. Player handle is a mdkPlayerAPI* defined here,
+// callbacks set by callbacks.cpp are stored in it and invoked by benchmarks as an mdk event source.
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mdk {
+enum class State : int8_t { NotRunning, Stopped = NotRunning, Running, Playing = Running, Paused };
+enum MediaStatus { NoMedia = 0, Unloaded = 1, Loading = 1<<1, Loaded = 1<<2, Prepared = 1<<8, Stalled = 1<<3, Buffering = 1<<4, Buffered = 1<<5, End = 1<<6, Seeking = 1<<7, Invalid = 1<<31 };
+inline bool flags_added(MediaStatus oldFlags, MediaStatus newFlags, MediaStatus testFlags) { return (oldFlags ^ newFlags) & newFlags & testFlags; }
+enum class MediaType : int8_t { Unknown = -1, Video = 0, Audio = 1, Subtitle = 3 };
+enum class SeekFlag { From0 = 1, FromStart = 1<<1, FromNow = 1<<2, Frame = 1<<6, KeyFrame = 1<<8, Fast = KeyFrame, InCache = 1<<10, Default = KeyFrame|FromStart|InCache };
+inline SeekFlag operator|(SeekFlag a, SeekFlag b) { return SeekFlag(int(a) | int(b)); }
+enum class LogLevel { Off, Error, Warning, Info, Debug, All };
+enum class PixelFormat { Unknown = -1, YUV420P, RGBA = 13 };
+
+struct MediaEvent {
+    int64_t error = 0;
+    std::string category;
+    std::string detail;
+    union {
+        struct { int stream; } decoder;
+        struct { int8_t type; } video;
+    };
+};
+
+struct VideoCodecParameters {
+    int width = 0;
+    int height = 0;
+    float frame_rate = 0;
+};
+
+struct VideoStreamInfo {
+    VideoCodecParameters codec;
+};
+
+struct MediaInfo {
+    int64_t start_time = 0;
+    int64_t duration = 0;
+    std::vector<VideoStreamInfo> video;
+};
+
+inline std::function<void(LogLevel, const char*)>& logHandler() {
+    static std::function<void(LogLevel, const char*)> h;
+    return h;
+}
+inline void setLogHandler(std::function<void(LogLevel, const char*)> cb) { logHandler() = std::move(cb); }
+inline void SetGlobalOption(const char*, const char*) {}
+
+class VideoFrame {
+public:
+    VideoFrame() = default;
+    VideoFrame(int, int, PixelFormat, int* = nullptr, uint8_t const** const = nullptr) {}
+    bool isValid() const { return false; }
+    explicit operator bool() const { return isValid(); }
+    const uint8_t* bufferData(int = 0) const { return nullptr; }
+    int bytesPerLine(int = 0) const { return 0; }
+    double timestamp() const { return 0; }
+    VideoFrame to(PixelFormat, int = -1, int = -1) { return {}; }
+    bool save(const char*, const char* = nullptr, float = -1) const { return false; }
+};
+} // namespace mdk
+
+struct mdkPlayerAPI {
+    std::function<bool(const mdk::MediaEvent&)> event;
+    std::function<void(mdk::State)> state;
+    std::function<bool(mdk::MediaStatus, mdk::MediaStatus)> status;
+    std::function<void(double, double, const std::vector<std::string>&)> subtitle;
+    std::function<bool(int64_t, bool*)> prepared;
+    std::function<void(int64_t)> seeked;
+    mdk::MediaInfo info;
+    std::mutex mtx;
+    std::condition_variable cv;
+    mdk::State current = mdk::State::Stopped;
+};
+
+namespace mdk {
+struct CallbackToken;
+
+class Player {
+public:
+    Player(const mdkPlayerAPI* cp = nullptr) : p(const_cast<mdkPlayerAPI*>(cp)) {}
+    virtual ~Player() = default;
+    void setMedia(const char*) {}
+    void setMedia(const char*, MediaType) {}
+    void setDecoders(MediaType, const std::vector<std::string>&) {}
+    void setActiveTracks(MediaType, const std::set<int>&) {}
+    // prepared callback is invoked in another thread like mdk
+    void prepare(int64_t = 0, std::function<bool(int64_t position, bool* boost)> cb = nullptr, SeekFlag = SeekFlag::FromStart) {
+        std::scoped_lock lock(p->mtx);
+        p->prepared = std::move(cb);
+    }
+    const MediaInfo& mediaInfo() const { return p->info; }
+    void set(State value) {
+        std::scoped_lock lock(p->mtx);
+        p->current = value;
+        p->cv.notify_all();
+    }
+    bool waitFor(State value, long timeout = -1) {
+        std::unique_lock lock(p->mtx);
+        return p->cv.wait_for(lock, std::chrono::milliseconds(timeout < 0 ? 1000 : timeout), [&]{ return p->current == value; });
+    }
+    Player& onStateChanged(std::function<void(State)> cb) { p->state = std::move(cb); return *this; }
+    Player& onMediaStatus(std::function<bool(MediaStatus oldValue, MediaStatus newValue)> cb, CallbackToken* = nullptr) { p->status = std::move(cb); return *this; }
+    Player& onSubtitleText(std::function<void(double start, double end, const std::vector<std::string>& texts)> cb) { p->subtitle = std::move(cb); return *this; }
+    Player& onEvent(std::function<bool(const MediaEvent&)> cb, CallbackToken* = nullptr) { p->event = std::move(cb); return *this; }
+    template<class Frame> Player& onFrame(std::function<int(Frame&, int)>) { return *this; }
+    Player& onSync(std::function<double()>, int = 10) { return *this; }
+    int64_t position() const { return 0; }
+    int64_t buffered(int64_t* = nullptr) const { return 0; }
+    bool seek(int64_t, SeekFlag, std::function<void(int64_t)> cb = nullptr) {
+        std::scoped_lock lock(p->mtx);
+        p->seeked = std::move(cb);
+        return true;
+    }
+    struct SnapshotRequest { uint8_t* data = nullptr; int width = 0; int height = 0; int stride = 0; bool subtitle = false; };
+    using SnapshotCallback = std::function<std::string(SnapshotRequest*, double frameTime)>;
+    void snapshot(SnapshotRequest*, SnapshotCallback, void* = nullptr) {}
+
+private:
+    mdkPlayerAPI* p;
+};
+} // namespace mdk
@@ -0,0 +1,266 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Headless render benchmark. Renders like TexturePlayer in linux/elinux plugins: mdk draws into fbo backed textures in a
+// surfaceless EGL context(mesa llvmpipe works w/o gpu), and reports render time, readback copies and throughput.
+// Usage: fvp_render_bench [-m url] [-s WxH] [-n frames] [-slots N] [-readback] [-rate r] [-json]
+#include "mdk/Player.h"
+#include "mdk/RenderAPI.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace chrono;
+
+struct Options {
+    string url = "avdevice://lavfi:testsrc2=size=1920x1080:rate=60"; // generated, no file required
+    int width = 1920;
+    int height = 1080;
+    int frames = 600;
+    int slots = 3;
+    bool readback = false;
+    float rate = 1.0f;
+    bool json = false;
+};
+
+static bool parse(int argc, char** argv, Options& opt)
+{
+    for (int i = 1; i < argc; ++i) {
+        const string a = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (a == "-m" && hasValue) {
+            opt.url = argv[++i];
+        } else if (a == "-s" && hasValue) {
+            if (sscanf(argv[++i], "%dx%d", &opt.width, &opt.height) != 2)
+                return false;
+        } else if (a == "-n" && hasValue) {
+            opt.frames = atoi(argv[++i]);
+        } else if (a == "-slots" && hasValue) {
+            opt.slots = std::clamp(atoi(argv[++i]), 1, 8);
+        } else if (a == "-rate" && hasValue) {
+            opt.rate = (float)atof(argv[++i]);
+        } else if (a == "-readback") {
+            opt.readback = true;
+        } else if (a == "-json") {
+            opt.json = true;
+        } else {
+            return false;
+        }
+    }
+    return opt.width > 0 && opt.height > 0 && opt.frames > 0;
+}
+
+class HeadlessGL
+{
+public:
+    ~HeadlessGL() {
+        if (disp_ == EGL_NO_DISPLAY)
+            return;
+        eglMakeCurrent(disp_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (surface_ != EGL_NO_SURFACE)
+            eglDestroySurface(disp_, surface_);
+        if (ctx_ != EGL_NO_CONTEXT)
+            eglDestroyContext(disp_, ctx_);
+        eglTerminate(disp_);
+    }
+
+    // surfaceless display if supported, then a 1x1 pbuffer if surfaceless context is not supported
+    bool create() {
+        const auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        const auto clientExts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (getPlatformDisplay && clientExts && strstr(clientExts, "EGL_MESA_platform_surfaceless"))
+            disp_ = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (disp_ == EGL_NO_DISPLAY)
+            disp_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (disp_ == EGL_NO_DISPLAY || !eglInitialize(disp_, nullptr, nullptr)) {
+            clog << "eglInitialize error: " << hex << eglGetError() << dec << endl;
+            return false;
+        }
+        eglBindAPI(EGL_OPENGL_ES_API);
+        const EGLint cfgAttrs[] = {
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+            EGL_NONE
+        };
+        EGLConfig cfg = nullptr;
+        EGLint nb = 0;
+        if (!eglChooseConfig(disp_, cfgAttrs, &cfg, 1, &nb) || nb < 1) {
+            clog << "eglChooseConfig error: " << hex << eglGetError() << dec << endl;
+            return false;
+        }
+        const EGLint ctxAttrs[] = { EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE };
+        ctx_ = eglCreateContext(disp_, cfg, EGL_NO_CONTEXT, ctxAttrs);
+        if (ctx_ == EGL_NO_CONTEXT) {
+            clog << "eglCreateContext error: " << hex << eglGetError() << dec << endl;
+            return false;
+        }
+        const auto exts = eglQueryString(disp_, EGL_EXTENSIONS);
+        if (!exts || !strstr(exts, "EGL_KHR_surfaceless_context")) {
+            const EGLint pbAttrs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+            surface_ = eglCreatePbufferSurface(disp_, cfg, pbAttrs);
+        }
+        if (!eglMakeCurrent(disp_, surface_, surface_, ctx_)) {
+            clog << "eglMakeCurrent error: " << hex << eglGetError() << dec << endl;
+            return false;
+        }
+        return true;
+    }
+
+    const char* renderer() const { return (const char*)glGetString(GL_RENDERER); }
+
+private:
+    EGLDisplay disp_ = EGL_NO_DISPLAY;
+    EGLContext ctx_ = EGL_NO_CONTEXT;
+    EGLSurface surface_ = EGL_NO_SURFACE;
+};
+
+struct RenderTarget {
+    GLuint fbo = 0;
+    GLuint tex = 0;
+};
+
+static bool createTargets(vector<RenderTarget>& targets, int w, int h)
+{
+    for (auto& t : targets) {
+        glGenFramebuffers(1, &t.fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, t.fbo);
+        glGenTextures(1, &t.tex);
+        glBindTexture(GL_TEXTURE_2D, t.tex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, t.tex, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            clog << "incomplete framebuffer " << t.fbo << endl;
+            return false;
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return true;
+}
+
+static void deleteTargets(vector<RenderTarget>& targets)
+{
+    for (auto& t : targets) {
+        glDeleteTextures(1, &t.tex);
+        glDeleteFramebuffers(1, &t.fbo);
+    }
+    targets.clear();
+}
+
+static double percentile(vector<double> v, double p)
+{
+    if (v.empty())
+        return 0;
+    const auto n = size_t(p * (v.size() - 1));
+    nth_element(v.begin(), v.begin() + n, v.end());
+    return v[n];
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parse(argc, argv, opt)) {
+        clog << "usage: " << argv[0] << " [-m url] [-s WxH] [-n frames] [-slots N] [-readback] [-rate r] [-json]" << endl;
+        return 2;
+    }
+    HeadlessGL gl;
+    if (!gl.create())
+        return 1;
+    vector<RenderTarget> targets(opt.slots);
+    if (!createTargets(targets, opt.width, opt.height))
+        return 1;
+
+    mutex mtx;
+    condition_variable cv;
+    uint64_t seq = 0; // increased in render callback like the plugins
+    bool ended = false;
+    mdk::Player player;
+    player.setDecoders(mdk::MediaType::Video, {"FFmpeg"});
+    player.setMedia(opt.url.data());
+    player.setPlaybackRate(opt.rate);
+    player.setVideoSurfaceSize(opt.width, opt.height);
+    mdk::GLRenderAPI ra{};
+    ra.fbo = -1; // render to the bound target
+    player.setRenderAPI(&ra);
+    player.setRenderCallback([&](void*) {
+        scoped_lock lock(mtx);
+        ++seq;
+        cv.notify_one();
+    });
+    player.onMediaStatus([&](mdk::MediaStatus oldValue, mdk::MediaStatus newValue) {
+        if (flags_added(oldValue, newValue, mdk::MediaStatus::End) || flags_added(oldValue, newValue, mdk::MediaStatus::Invalid)) {
+            scoped_lock lock(mtx);
+            ended = true;
+            cv.notify_one();
+        }
+        return true;
+    });
+    player.set(mdk::State::Playing);
+
+    vector<double> renderMs;
+    renderMs.reserve(opt.frames);
+    vector<uint8_t> pixels(opt.readback ? size_t(opt.width) * opt.height * 4 : 0);
+    double readbackMs = 0;
+    uint64_t rendered = 0;
+    int slot = 0;
+    const auto t0 = steady_clock::now();
+    while ((int)renderMs.size() < opt.frames) {
+        {
+            unique_lock lock(mtx);
+            if (!cv.wait_for(lock, seconds(5), [&]{ return seq != rendered || ended; }) || (ended && seq == rendered))
+                break;
+            rendered = seq;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, targets[slot].fbo);
+        const auto t = steady_clock::now();
+        player.renderVideo();
+        glFinish(); // include gpu time
+        renderMs.push_back(duration<double, milli>(steady_clock::now() - t).count());
+        if (opt.readback) {
+            const auto r = steady_clock::now();
+            glReadPixels(0, 0, opt.width, opt.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+            readbackMs += duration<double, milli>(steady_clock::now() - r).count();
+        }
+        slot = (slot + 1) % opt.slots;
+    }
+    const auto elapsed = duration<double>(steady_clock::now() - t0).count();
+    player.setRenderCallback(nullptr);
+    player.onMediaStatus(nullptr);
+    player.set(mdk::State::Stopped);
+    player.waitFor(mdk::State::Stopped);
+    player.setVideoSurfaceSize(-1, -1); // release mdk gl resources in current context
+    deleteTargets(targets);
+
+    const auto frames = renderMs.size();
+    double total = 0;
+    for (auto v : renderMs)
+        total += v;
+    const auto avg = frames ? total / frames : 0;
+    const auto copies = opt.readback ? frames : 0;
+    const auto copyMB = double(copies) * opt.width * opt.height * 4 / (1024 * 1024);
+    const auto fps = elapsed > 0 ? frames / elapsed : 0;
+    if (opt.json) {
+        printf("{\"renderer\":\"%s\",\"width\":%d,\"height\":%d,\"slots\":%d,\"frames\":%zu,\"render_avg_ms\":%.3f,\"render_p50_ms\":%.3f,"
+               "\"render_p95_ms\":%.3f,\"render_max_ms\":%.3f,\"copies\":%zu,\"copy_mb\":%.1f,\"copy_avg_ms\":%.3f,\"fps\":%.1f}\n"
+               , gl.renderer(), opt.width, opt.height, opt.slots, frames, avg, percentile(renderMs, 0.5)
+               , percentile(renderMs, 0.95), percentile(renderMs, 1.0), copies, copyMB, copies ? readbackMs / copies : 0, fps);
+    } else {
+        printf("renderer: %s\n%dx%d, %d slots, %zu frames in %.2fs, %.1f fps\n", gl.renderer(), opt.width, opt.height, opt.slots, frames, elapsed, fps);
+        printf("render ms: avg %.3f, p50 %.3f, p95 %.3f, max %.3f\n", avg, percentile(renderMs, 0.5), percentile(renderMs, 0.95), percentile(renderMs, 1.0));
+        printf("readback copies: %zu, %.1f MB, avg %.3f ms\n", copies, copyMB, copies ? readbackMs / copies : 0);
+    }
+    return frames > 0 ? 0 : 1;
+}
@@ -0,0 +1,166 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Thumbnail strip benchmark. Decodes key frames of a media file at evenly spaced positions by MdkThumbnails() with 1..N worker players.
+// 1 worker seeks and decodes frames in turn, i.e. sequential seek+snapshot w/o rendering, readback and dart round trips, a lower bound of
+// the sequential dart path. Reports wall time, time per frame, speedup over 1 worker and frames decoded.
+// Usage: fvp_thumbnails_bench -m url [-n count] [-s WxH] [-w maxWorkers] [-r repeat] [-json]
+#include "mdk/Player.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "dart_api_types.h"
+#include "callbacks.h"
+
+using namespace std;
+using namespace chrono;
+
+struct Options {
+    string url;
+    int count = 20;
+    int width = 160;
+    int height = 90;
+    int workers = 4;
+    int repeat = 3;
+    bool json = false;
+};
+
+static bool parse(int argc, char** argv, Options& opt)
+{
+    for (int i = 1; i < argc; ++i) {
+        const string a = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (a == "-m" && hasValue) {
+            opt.url = argv[++i];
+        } else if (a == "-n" && hasValue) {
+            opt.count = atoi(argv[++i]);
+        } else if (a == "-s" && hasValue) {
+            if (sscanf(argv[++i], "%dx%d", &opt.width, &opt.height) != 2)
+                return false;
+        } else if (a == "-w" && hasValue) {
+            opt.workers = atoi(argv[++i]);
+        } else if (a == "-r" && hasValue) {
+            opt.repeat = atoi(argv[++i]);
+        } else if (a == "-json") {
+            opt.json = true;
+        } else {
+            return false;
+        }
+    }
+    return !opt.url.empty() && opt.count > 0 && opt.width > 0 && opt.height > 0 && opt.workers > 0 && opt.repeat > 0;
+}
+
+// the isolate of MdkThumbnails() result
+struct Result {
+    mutex mtx;
+    condition_variable cv;
+    bool done = false;
+    int decoded = 0; // timestamps >= 0
+};
+static Result result;
+
+static bool postCObject(Dart_Port, Dart_CObject* msg)
+{
+    const auto& arr = msg->value.as_array;
+    int decoded = 0;
+    if (arr.length == 3 && arr.values[1]->type == Dart_CObject_kTypedData) {
+        const auto& ts = arr.values[1]->value.as_typed_data;
+        auto times = reinterpret_cast<const int64_t*>(ts.values);
+        decoded = (int)std::count_if(times, times + ts.length, [](int64_t t) { return t >= 0; });
+        const auto& strip = arr.values[2]->value.as_external_typed_data;
+        strip.callback(nullptr, strip.peer); // dart finalizer, return the strip to the pool
+    }
+    scoped_lock lock(result.mtx);
+    result.decoded = decoded;
+    result.done = true;
+    result.cv.notify_one();
+    return true;
+}
+
+static int64_t mediaDuration(const string& url)
+{
+    mdk::Player player;
+    player.setMedia(url.data());
+    int64_t ms = 0;
+    mutex mtx;
+    condition_variable cv;
+    bool prepared = false;
+    player.prepare(0, [&](int64_t position, bool*) {
+        scoped_lock lock(mtx);
+        ms = position < 0 ? -1 : player.mediaInfo().duration;
+        prepared = true;
+        cv.notify_one();
+        return false; // stop after probing
+    });
+    unique_lock lock(mtx);
+    cv.wait_for(lock, seconds(10), [&]{ return prepared; });
+    return ms;
+}
+
+// return wall time in microseconds
+static int64_t run(const Options& opt, const vector<int64_t>& positions, int workers, int& decoded)
+{
+    {
+        scoped_lock lock(result.mtx);
+        result.done = false;
+        result.decoded = 0;
+    }
+    const auto t0 = steady_clock::now();
+    if (!MdkThumbnails(opt.url.data(), positions.data(), (int)positions.size(), opt.width, opt.height, workers, (void*)&postCObject, 1))
+        return -1;
+    unique_lock lock(result.mtx);
+    if (!result.cv.wait_for(lock, seconds(60 + 5 * positions.size()), []{ return result.done; }))
+        return -1;
+    decoded = result.decoded;
+    return duration_cast<microseconds>(steady_clock::now() - t0).count();
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parse(argc, argv, opt)) {
+        fprintf(stderr, "usage: %s -m url [-n count] [-s WxH] [-w maxWorkers] [-r repeat] [-json]\n", argv[0]);
+        return 2;
+    }
+    const auto ms = mediaDuration(opt.url);
+    if (ms <= 0) {
+        fprintf(stderr, "can not open %s or no duration\n", opt.url.data());
+        return 1;
+    }
+    vector<int64_t> positions(opt.count);
+    for (int i = 0; i < opt.count; ++i)
+        positions[i] = ms * i / opt.count;
+
+    double sequential = 0;
+    for (int w = 1; w <= opt.workers; ++w) {
+        int64_t best = -1;
+        int decoded = 0;
+        for (int r = 0; r < opt.repeat; ++r) { // the first one warms up io cache
+            int d = 0;
+            const auto us = run(opt, positions, w, d);
+            if (us < 0) {
+                fprintf(stderr, "timeout, workers %d\n", w);
+                return 1;
+            }
+            if (best < 0 || us < best) {
+                best = us;
+                decoded = d;
+            }
+        }
+        if (w == 1)
+            sequential = double(best);
+        const auto speedup = sequential / best;
+        if (opt.json)
+            printf("{\"bench\":\"thumbnails\",\"workers\":%d,\"frames\":%d,\"decoded\":%d,\"ms\":%.1f,\"ms_per_frame\":%.2f,\"speedup\":%.2f}\n", w, opt.count, decoded, best / 1000.0, best / 1000.0 / opt.count, speedup);
+        else
+            printf("thumbnails %dx%d, %d workers: %d/%d frames decoded, %.1f ms, %.2f ms/frame, %.2fx of 1 worker\n", opt.width, opt.height, w, decoded, opt.count, best / 1000.0, best / 1000.0 / opt.count, speedup);
+    }
+    return 0;
+}
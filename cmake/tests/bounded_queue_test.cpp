@@ -0,0 +1,100 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Stress fvp::BoundedQueue like log forwarding: several threads push lines while 1 thread drains, full queue drops
+#include "bounded_queue.h"
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#define CHECK(x) do { \
+        if (!(x)) { \
+            fprintf(stderr, "%s:%d CHECK failed: %s\n", __FILE__, __LINE__, #x); \
+            return 1; \
+        } \
+    } while (false)
+
+struct Line {
+    int producer;
+    int64_t seq;
+    string text;
+};
+
+int main()
+{
+    {
+        fvp::BoundedQueue<int> q(3);
+        CHECK(q.capacity() == 4);
+        for (int i = 0; i < 4; ++i)
+            CHECK(q.push([i](int& v) { v = i; }));
+        CHECK(!q.push([](int& v) { v = -1; }));
+        CHECK(q.size() == 4);
+        for (int i = 0; i < 4; ++i) {
+            int v = -1;
+            CHECK(q.pop([&](int& x) { v = x; }) && v == i);
+        }
+        CHECK(!q.pop([](int&) {}));
+    }
+
+    constexpr int kThreads = 6;
+    constexpr int kLines = 100000;
+    fvp::BoundedQueue<Line> q(256);
+    atomic<int64_t> pushed = 0;
+    atomic<int64_t> dropped = 0;
+    atomic<bool> done = false;
+    int64_t popped = 0;
+    int errors = 0;
+    vector<int64_t> last(kThreads, -1);
+
+    thread consumer([&]{
+        while (true) {
+            const bool finished = done;
+            bool any = false;
+            while (q.pop([&](Line& l) {
+                    // per producer order is kept, lines may be dropped
+                    if (l.seq <= last[l.producer] || l.text != to_string(l.seq))
+                        ++errors;
+                    last[l.producer] = l.seq;
+                })) {
+                any = true;
+                ++popped;
+            }
+            if (finished && !any)
+                break;
+            this_thread::yield();
+        }
+    });
+    vector<thread> producers;
+    for (int t = 0; t < kThreads; ++t) {
+        producers.emplace_back([&, t]{
+            for (int64_t i = 0; i < kLines; ++i) {
+                if (q.push([&](Line& l) {
+                        l.producer = t;
+                        l.seq = i;
+                        l.text.assign(to_string(i));
+                    }))
+                    ++pushed;
+                else
+                    ++dropped;
+                if (i % 16 == 0) // give the consumer a chance on few cores
+                    this_thread::yield();
+            }
+        });
+    }
+    for (auto& p : producers)
+        p.join();
+    done = true;
+    consumer.join();
+
+    CHECK(errors == 0);
+    CHECK(pushed + dropped == kThreads * kLines);
+    CHECK(popped == pushed);
+    CHECK(q.size() == 0);
+    printf("%lld pushed, %lld dropped\n", (long long)pushed.load(), (long long)dropped.load());
+    return 0;
+}
@@ -0,0 +1,83 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// fvp::PlayerStatus layout copied for dart, and seqlock updates
+#include "stats.h"
+#include <cstddef>
+#include <cstdio>
+#include <thread>
+#include <tuple>
+
+using namespace std;
+
+#define CHECK(x) do { \
+        if (!(x)) { \
+            fprintf(stderr, "%s:%d CHECK failed: %s\n", __FILE__, __LINE__, #x); \
+            return 1; \
+        } \
+    } while (false)
+
+int main()
+{
+    // offsets of _PlayerStatus in player.dart
+    CHECK(offsetof(fvp::PlayerStatus, seq) == 0);
+    CHECK(offsetof(fvp::PlayerStatus, position) == 8);
+    CHECK(offsetof(fvp::PlayerStatus, buffered) == 16);
+    CHECK(offsetof(fvp::PlayerStatus, duration) == 24);
+    CHECK(offsetof(fvp::PlayerStatus, renderTime) == 32);
+    CHECK(offsetof(fvp::PlayerStatus, fps) == 40);
+    CHECK(offsetof(fvp::PlayerStatus, state) == 48);
+    CHECK(offsetof(fvp::PlayerStatus, mediaStatus) == 52);
+    CHECK(offsetof(fvp::PlayerStatus, videoWidth) == 56);
+    CHECK(offsetof(fvp::PlayerStatus, videoHeight) == 60);
+
+    fvp::PlayerCounters c;
+    const auto& s = c.status;
+    fvp::statusRendered(c, -1); // not rendered
+    fvp::statusFrame(c, -1);
+    CHECK(s.seq == 0 && s.renderTime == 0);
+
+    c.startTime = 1000;
+    fvp::statusFrame(c, 3.5);
+    CHECK(s.seq == 2);
+    CHECK(s.position == 2500);
+    fvp::statusRendered(c, 3.5);
+    CHECK(s.seq == 4);
+    CHECK(s.renderTime > 0);
+
+    // readers never see fields of different updates, and writers of different threads are serialized
+    {
+        fvp::StatusWriter w(c); // consistent before writers start
+        w->position.store(0, memory_order_relaxed);
+    }
+    CHECK(s.seq == 6);
+    constexpr int kUpdates = 100000;
+    auto writer = [&](int64_t sign) {
+        for (int i = 1; i <= kUpdates; ++i) {
+            fvp::StatusWriter w(c);
+            w->position.store(sign * i, memory_order_relaxed);
+            w->buffered.store(sign * i, memory_order_relaxed);
+            w->duration.store(sign * i * 2, memory_order_relaxed);
+        }
+    };
+    thread w1(writer, 1);
+    thread w2(writer, -1);
+    int errors = 0;
+    int64_t reads = 0;
+    while (s.seq.load(memory_order_acquire) < 6 + 4 * kUpdates) {
+        const auto v = fvp::readStatus(s, [](const fvp::PlayerStatus& s) {
+            return make_tuple(s.position.load(memory_order_relaxed), s.buffered.load(memory_order_relaxed), s.duration.load(memory_order_relaxed));
+        });
+        if (get<0>(v) != get<1>(v) || get<0>(v) * 2 != get<2>(v))
+            ++errors;
+        ++reads;
+    }
+    w1.join();
+    w2.join();
+    CHECK(errors == 0);
+    CHECK(reads > 0);
+    CHECK(s.seq == 6 + 4 * kUpdates);
+    CHECK(s.position == kUpdates || s.position == -kUpdates);
+    return 0;
+}
@@ -0,0 +1,99 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Stress fvp::Registry like a thumbnail grid: players are created, looked up and destroyed from several threads
+#include "registry.h"
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static atomic<int> gAlive = 0;
+
+struct FakePlayer {
+    FakePlayer() : FakePlayer(0) {}
+    explicit FakePlayer(int64_t h) : handle(h) { ++gAlive; }
+    ~FakePlayer() { --gAlive; }
+    int64_t handle;
+};
+
+#define CHECK(x) do { \
+        if (!(x)) { \
+            fprintf(stderr, "%s:%d CHECK failed: %s\n", __FILE__, __LINE__, #x); \
+            return 1; \
+        } \
+    } while (false)
+
+int main()
+{
+    constexpr int kThreads = 8;
+    constexpr int kPlayersPerThread = 4000;
+    fvp::Registry<FakePlayer> players;
+    atomic<int> lookups = 0;
+    atomic<int> errors = 0;
+    atomic<bool> done = false;
+
+    // readers: lookup random handles while they are created and destroyed, like mdk threads and ffi calls
+    vector<thread> readers;
+    for (int i = 0; i < 2; ++i) {
+        readers.emplace_back([&]{
+            uint64_t x = 88172645463325252ull;
+            while (!done) {
+                x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+                const auto h = int64_t((x % (kThreads * kPlayersPerThread)) * 16 + 0x10000);
+                if (const auto p = players.get(h); p && p->handle != h)
+                    ++errors;
+                ++lookups;
+            }
+        });
+    }
+
+    vector<thread> writers;
+    for (int t = 0; t < kThreads; ++t) {
+        writers.emplace_back([&, t]{
+            for (int i = 0; i < kPlayersPerThread; ++i) {
+                const auto h = int64_t((t * kPlayersPerThread + i) * 16 + 0x10000); // aligned like pointers
+                players.set(h, make_shared<FakePlayer>(h));
+                const auto p = players.get(h);
+                if (!p || p->handle != h)
+                    ++errors;
+                if (i % 3 == 0) // keep some alive until the end
+                    continue;
+                if (!players.take(h))
+                    ++errors;
+                if (players.get(h))
+                    ++errors;
+            }
+        });
+    }
+    for (auto& w : writers)
+        w.join();
+    done = true;
+    for (auto& r : readers)
+        r.join();
+
+    CHECK(errors == 0);
+    const auto kept = kThreads * ((kPlayersPerThread + 2) / 3);
+    CHECK(players.size() == size_t(kept));
+    CHECK(gAlive == kept);
+    int visited = 0;
+    players.forEach([&](int64_t h, const shared_ptr<FakePlayer>& p) {
+        if (p->handle == h)
+            ++visited;
+    });
+    CHECK(visited == kept);
+    {
+        const auto created = players.getOrCreate(0x10);
+        CHECK(created && players.getOrCreate(0x10) == created);
+        CHECK(players.size() == size_t(kept + 1));
+    }
+    players.clear();
+    CHECK(players.size() == 0);
+    CHECK(gAlive == 0);
+    printf("%d players, %d lookups\n", kThreads * kPlayersPerThread, lookups.load());
+    return 0;
+}
@@ -0,0 +1,101 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Size matching, LRU eviction and per context pools of fvp::RenderTargetPool, targets are fake gl names
+#include "render_target_pool.h"
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#define CHECK(x) do { \
+        if (!(x)) { \
+            fprintf(stderr, "%s:%d CHECK failed: %s\n", __FILE__, __LINE__, #x); \
+            return 1; \
+        } \
+    } while (false)
+
+namespace fvp {
+atomic<int64_t>& renderTargetPoolLimit()
+{
+    static atomic<int64_t> limit = 0;
+    return limit;
+}
+} // namespace fvp
+
+int main()
+{
+    vector<int> deleted;
+    fvp::RenderTargetPool<int> pool([&](int& t) { deleted.push_back(t); });
+    fvp::renderTargetPoolLimit() = 300;
+
+    CHECK(!pool.acquire(16, 16));
+    pool.release(16, 16, 100, 1);
+    pool.release(32, 32, 100, 2);
+    pool.release(16, 16, 100, 3);
+    CHECK(pool.size() == 3);
+    CHECK(pool.bytes() == 300);
+    CHECK(deleted.empty());
+    // the most recently released of the same size
+    CHECK(pool.acquire(16, 16) == 3);
+    CHECK(!pool.acquire(16, 32));
+    CHECK(pool.hits() == 1);
+    CHECK(pool.misses() == 2);
+    CHECK(pool.bytes() == 200);
+
+    // over limit: least recently released first
+    pool.release(64, 64, 150, 4);
+    CHECK(deleted == vector<int>{1});
+    CHECK(pool.bytes() == 250);
+    CHECK(!pool.acquire(16, 16));
+    CHECK(pool.acquire(32, 32) == 2);
+
+    // a target larger than limit is not cached
+    pool.release(128, 128, 400, 5);
+    CHECK((deleted == vector<int>{1, 4, 5}));
+    CHECK(pool.size() == 0);
+    CHECK(pool.bytes() == 0);
+
+    fvp::renderTargetPoolLimit() = 1000;
+    pool.release(16, 16, 100, 6);
+    pool.release(16, 16, 100, 7);
+    pool.clear();
+    CHECK((deleted == vector<int>{1, 4, 5, 7, 6}));
+
+    // limit 0: no cache
+    fvp::renderTargetPoolLimit() = 0;
+    pool.release(16, 16, 1, 8);
+    CHECK(deleted.back() == 8);
+    CHECK(pool.size() == 0);
+
+    // 1 pool per context, the deleter of the first call is used
+    int a = 0, b = 0;
+    auto& p1 = fvp::RenderTargetPool<int>::of(&a, [](int&) {});
+    auto& p2 = fvp::RenderTargetPool<int>::of(&b, [](int&) {});
+    CHECK(&p1 == &fvp::RenderTargetPool<int>::of(&a, nullptr));
+    CHECK(&p1 != &p2);
+
+    // released and acquired by several threads, nothing is lost or duplicated
+    fvp::renderTargetPoolLimit() = int64_t(1) << 40;
+    constexpr int kThreads = 4;
+    constexpr int kTargets = 1000;
+    vector<thread> threads;
+    atomic<int> acquired = 0;
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&, i] {
+            for (int n = 0; n < kTargets; ++n) {
+                p1.release(n % 3, 1, 1, i * kTargets + n);
+                if (n % 2 && p1.acquire(n % 3, 1))
+                    ++acquired;
+            }
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+    CHECK(int(p1.size()) + acquired == kThreads * kTargets);
+    CHECK(p1.bytes() == int64_t(p1.size()));
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,113 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// fvp::SeekScheduler: 1 seek in flight, the latest pending one replaces older ones, relative seeks are merged, stale results ignored
+#include "seek_scheduler.h"
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using fvp::SeekScheduler;
+
+#define CHECK(x) do { \
+        if (!(x)) { \
+            fprintf(stderr, "%s:%d CHECK failed: %s\n", __FILE__, __LINE__, #x); \
+            return 1; \
+        } \
+    } while (false)
+
+int main()
+{
+    atomic<int64_t> elided = 0;
+    SeekScheduler s(elided);
+    constexpr int kAbs = SeekScheduler::kFromStart;
+    constexpr int kRel = SeekScheduler::kFromNow;
+
+    CHECK(s.request({1000, kAbs, 1}));
+    CHECK(!s.request({2000, kAbs, 2}));
+    CHECK(!s.request({3000, kAbs, 3})); // replaces 2
+    CHECK(elided == 1);
+    CHECK(!s.finished(2)); // not in flight
+    auto r = s.finished(1);
+    CHECK(r && r->seq == 3 && r->position == 3000 && r->flags == kAbs);
+    CHECK(!s.finished(3)); // nothing pending, idle now
+    CHECK(s.request({4000, kAbs, 4}));
+
+    // relative requests are merged into pending
+    CHECK(!s.request({500, kRel, 5}));
+    CHECK(!s.request({-200, kRel, 6}));
+    CHECK(!s.request({100, kRel, 7}));
+    CHECK(elided == 3);
+    r = s.finished(4);
+    CHECK(r && r->seq == 7 && r->position == 400 && r->flags == kRel);
+
+    // relative merged into absolute keeps the origin
+    CHECK(!s.request({1000, kAbs | SeekScheduler::kFrom0, 8}));
+    CHECK(!s.request({-300, kRel, 9}));
+    r = s.finished(7);
+    CHECK(r && r->seq == 9 && r->position == 700 && r->flags == (kAbs | SeekScheduler::kFrom0));
+
+    // frame step can not be merged with time offset
+    CHECK(!s.request({1, kRel | SeekScheduler::kFrame, 10}));
+    CHECK(!s.request({1000, kRel, 11}));
+    r = s.finished(9);
+    CHECK(r && r->seq == 11 && r->position == 1000 && r->flags == kRel);
+
+    // reset drops pending, and the result of the old in-flight seek is ignored
+    CHECK(!s.request({5000, kAbs, 12}));
+    r = s.reset();
+    CHECK(r && r->seq == 12);
+    CHECK(!s.finished(11));
+    CHECK(!s.reset());
+    CHECK(s.request({6000, kAbs, 13}));
+
+    // cancel drops the pending request only
+    CHECK(!s.request({7000, kAbs, 14}));
+    CHECK(!s.cancel(13)); // in flight
+    CHECK(s.cancel(14));
+    CHECK(!s.cancel(14));
+    CHECK(!s.finished(13));
+
+    // every request is either issued or elided once, and 1 seek in flight at most
+    elided = 0;
+    constexpr int kThreads = 4;
+    constexpr int kRequests = 10000;
+    atomic<int64_t> seq = 100;
+    atomic<int> issued = 0;
+    atomic<int> inFlight = 0;
+    atomic<int> errors = 0;
+    auto complete = [&](int64_t id) {
+        for (optional<SeekScheduler::Request> next; ; id = next->seq) {
+            if (inFlight.fetch_sub(1) != 1)
+                ++errors;
+            next = s.finished(id);
+            if (!next)
+                break;
+            if (inFlight.fetch_add(1) != 0)
+                ++errors;
+            ++issued;
+        }
+    };
+    vector<thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&]{
+            for (int n = 0; n < kRequests; ++n) {
+                const auto id = ++seq;
+                if (!s.request({n, kAbs, id}))
+                    continue;
+                if (inFlight.fetch_add(1) != 0)
+                    ++errors;
+                ++issued;
+                complete(id);
+            }
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+    CHECK(errors == 0);
+    CHECK(issued + elided == kThreads * kRequests);
+    printf("issued: %d, elided: %lld\n", issued.load(), (long long)elided.load());
+    return 0;
+}
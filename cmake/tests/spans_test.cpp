@@ -0,0 +1,76 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Record fvp spans from short lived threads and dump chrome trace json
+#include "spans.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#define CHECK(x) do { \
+        if (!(x)) { \
+            fprintf(stderr, "%s:%d CHECK failed: %s\n", __FILE__, __LINE__, #x); \
+            return 1; \
+        } \
+    } while (false)
+
+static size_t countOf(const string& s, const string& sub)
+{
+    size_t n = 0;
+    for (auto i = s.find(sub); i != string::npos; i = s.find(sub, i + 1))
+        ++n;
+    return n;
+}
+
+int main()
+{
+    auto& r = fvp::SpanRecorder::instance();
+    { fvp::ScopedSpan s("disabled"); }
+    r.setEnabled(true);
+    { fvp::ScopedSpan s("main"); } // own a buffer before others are reused
+    constexpr int kThreads = 4;
+    for (int round = 0; round < 3; ++round) { // threads exit and buffers are reused
+        vector<thread> threads;
+        for (int i = 0; i < kThreads; ++i) {
+            threads.emplace_back([=]{
+                for (int n = 0; n < 40; ++n) { // all may share 1 buffer if threads do not overlap
+                    fvp::ScopedSpan s("populate", 0x1000 + i);
+                    fvp::ScopedSpan s2("renderVideo");
+                }
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+    }
+    for (size_t n = 0; n < fvp::SpanRecorder::kCapacity + 10; ++n) // wrap
+        fvp::ScopedSpan s("wrap");
+    const auto t0 = fvp::SpanRecorder::now();
+    r.record("first frame", 0x1000, t0 - 1000, t0);
+    r.setEnabled(false);
+
+    const auto path = filesystem::temp_directory_path() / "fvp_spans_test.json";
+    CHECK(r.dump(path.string().data()));
+    ifstream f(path);
+    const string json((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+    filesystem::remove(path);
+    CHECK(json.starts_with("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+    CHECK(json.ends_with("]}\n"));
+    CHECK(countOf(json, "\"disabled\"") == 0);
+    CHECK(countOf(json, "\"populate\"") == 3 * kThreads * 40);
+    CHECK(countOf(json, "\"renderVideo\"") == 3 * kThreads * 40);
+    CHECK(countOf(json, "\"player\":\"0x1003\"") == 3 * 40);
+    CHECK(countOf(json, "\"name\":\"first frame\"") == 1);
+    CHECK(countOf(json, "\"dur\":1000,") == 1);
+    // main thread buffer wrapped, only the latest spans are kept
+    CHECK(countOf(json, "\"wrap\"") == fvp::SpanRecorder::kCapacity - 1);
+    CHECK(countOf(json, "\"main\"") == 0);
+    printf("%zu bytes json\n", json.size());
+    return 0;
+}
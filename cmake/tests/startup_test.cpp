@@ -0,0 +1,87 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Startup marks of fvp::PlayerCounters and the phase histogram
+#include "stats.h"
+#include <cstdio>
+#include <thread>
+
+using namespace std;
+
+#define CHECK(x) do { \
+        if (!(x)) { \
+            fprintf(stderr, "%s:%d CHECK failed: %s\n", __FILE__, __LINE__, #x); \
+            return 1; \
+        } \
+    } while (false)
+
+namespace fvp {
+StartupHistogram& startupHistogram()
+{
+    static StartupHistogram h;
+    return h;
+}
+} // namespace fvp
+
+static int64_t total(int phase)
+{
+    int64_t n = 0;
+    for (const auto& c : fvp::startupHistogram().counts[phase])
+        n += c;
+    return n;
+}
+
+int main()
+{
+    using H = fvp::StartupHistogram;
+    CHECK(H::bucketOf(0) == 0);
+    CHECK(H::bucketOf(999) == 0);
+    CHECK(H::bucketOf(1000) == 1);
+    CHECK(H::bucketOf(1999) == 1);
+    CHECK(H::bucketOf(2000) == 2);
+    CHECK(H::bucketOf(3999) == 2);
+    CHECK(H::bucketOf(4000) == 3);
+    CHECK(H::bucketOf(int64_t(1) << 40) == H::kBuckets - 1);
+
+    fvp::PlayerCounters c;
+    fvp::markStartup(c, fvp::FirstPresent); // not started by prepare
+    CHECK(c.startup[fvp::FirstPresent] == 0);
+    CHECK(total(fvp::Present) == 0);
+
+    fvp::resetStartup(c);
+    fvp::markStartup(c, fvp::Prepared);
+    this_thread::sleep_for(chrono::milliseconds(3));
+    fvp::markStartup(c, fvp::FirstRender); // before decoder event
+    fvp::markStartup(c, fvp::VideoDecoder);
+    fvp::markStartup(c, fvp::FirstPresent);
+    for (int i = 0; i < 10; ++i) // only the first one counts
+        fvp::markStartup(c, fvp::FirstPresent);
+    for (int i = fvp::Prepare; i < fvp::MarkCount; ++i)
+        CHECK(c.startup[i] > 0);
+    CHECK(c.startup[fvp::FirstRender] - c.startup[fvp::Prepared] >= 3000);
+    for (int i = 0; i < fvp::PhaseCount; ++i)
+        CHECK(total(i) == 1);
+    const auto& h = fvp::startupHistogram();
+    CHECK(h.counts[fvp::Render][2] + h.counts[fvp::Render][3] + h.counts[fvp::Render][4] == 1); // >= 3ms, 2 buckets for slow machines
+    CHECK(h.counts[fvp::Total][0] == 0);
+
+    // a new media
+    fvp::resetStartup(c);
+    CHECK(c.startup[fvp::FirstPresent] == 0);
+    fvp::markStartup(c, fvp::FirstPresent); // audio only, no other marks
+    CHECK(total(fvp::Present) == 2);
+    CHECK(total(fvp::Total) == 2);
+    CHECK(total(fvp::Open) == 1);
+
+    // a late frame after the port is unregistered
+    fvp::resetStartup(c);
+    c.registered = false;
+    fvp::markStartup(c, fvp::FirstRender);
+    fvp::markStartup(c, fvp::FirstPresent);
+    CHECK(c.startup[fvp::FirstPresent] == 0);
+    CHECK(total(fvp::Present) == 2);
+    CHECK(total(fvp::Total) == 2);
+    printf("ok\n");
+    return 0;
+}
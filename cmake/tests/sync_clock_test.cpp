@@ -0,0 +1,86 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// fvp::SyncClock: extrapolation, drift stats, and readers never see a torn update while writers race
+#include "sync_clock.h"
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#define CHECK(x) do { \
+        if (!(x)) { \
+            fprintf(stderr, "%s:%d CHECK failed: %s\n", __FILE__, __LINE__, #x); \
+            return 1; \
+        } \
+    } while (false)
+
+static bool near(double a, double b)
+{
+    return fabs(a - b) < 1e-9;
+}
+
+int main()
+{
+    {
+        fvp::SyncClock c;
+        CHECK(c.position(1000) == 0); // paused at 0
+        c.update(10.0, 1.0, 1000000);
+        CHECK(near(c.position(1000000), 10.0));
+        CHECK(near(c.position(1500000), 10.5));
+        auto s = c.stats();
+        CHECK(s.updates == 1 && s.reads == 3 && s.maxDriftUs == 0);
+
+        c.update(11.0, 2.0, 2000000); // predicted 11.0
+        CHECK(c.stats().lastDriftUs == 0);
+        CHECK(near(c.position(2250000), 11.5));
+        c.update(11.48, 2.0, 2250000); // predicted 11.5, master is 20ms behind
+        s = c.stats();
+        CHECK(s.lastDriftUs == -20000);
+        CHECK(s.maxDriftUs == 20000);
+        c.update(11.0, 0, 2500000); // predicted 11.98, master seeked back and paused
+        s = c.stats();
+        CHECK(s.lastDriftUs == -980000);
+        CHECK(s.maxDriftUs == 980000);
+        CHECK(s.meanDriftUs == (0 + 20000 + 980000) / 3);
+        CHECK(near(c.position(9000000), 11.0)); // paused
+    }
+
+    // every update writes position == time(us) at rate 1e6, so a consistent read at time 0 is 0, and a torn one is not
+    fvp::SyncClock c;
+    constexpr int kWriters = 2;
+    constexpr int kReaders = 2;
+    constexpr int kUpdates = 200000;
+    atomic<bool> done = false;
+    atomic<int> errors = 0;
+    vector<thread> threads;
+    for (int i = 0; i < kReaders; ++i) {
+        threads.emplace_back([&]{
+            while (!done) {
+                if (c.position(0) != 0)
+                    ++errors;
+            }
+        });
+    }
+    for (int i = 0; i < kWriters; ++i) {
+        threads.emplace_back([&, i]{
+            for (int n = 1; n <= kUpdates; ++n) {
+                const auto v = n * kWriters + i;
+                c.update(v, 1e6, v);
+            }
+        });
+    }
+    for (int i = kReaders; i < kReaders + kWriters; ++i)
+        threads[i].join();
+    done = true;
+    for (int i = 0; i < kReaders; ++i)
+        threads[i].join();
+    const auto s = c.stats();
+    CHECK(errors == 0);
+    CHECK(s.updates == kWriters * kUpdates);
+    printf("reads: %lld, retries: %lld\n", (long long)s.reads, (long long)s.retries);
+    return 0;
+}
@@ -0,0 +1,127 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Write fvp::TraceFile until it wraps many times, and from several threads, then decode it like fvp_trace_dump
+#include "trace.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#define CHECK(x) do { \
+        if (!(x)) { \
+            fprintf(stderr, "%s:%d CHECK failed: %s\n", __FILE__, __LINE__, #x); \
+            return 1; \
+        } \
+    } while (false)
+
+static vector<uint8_t> readFile(const filesystem::path& path)
+{
+    ifstream f(path, ios::binary);
+    return vector<uint8_t>((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+}
+
+int main()
+{
+    const auto path = filesystem::temp_directory_path() / "fvp_trace_test.trace";
+    {
+        auto t = fvp::TraceFile::create(path.string().data(), 64 << 10);
+        CHECK(t);
+        t->append(fvp::TraceKind::Log, 3, 0, 0, 0, "hello");
+        t->append(fvp::TraceKind::Event, 0, 0x1000, -1, 0, "reader.buffering", "progress");
+        t->append(fvp::TraceKind::State, 0, 0x1000, 0, 1);
+    }
+    {
+        const auto data = readFile(path);
+        vector<string> texts;
+        CHECK(fvp::readTrace(data.data(), data.size(), [&](const fvp::TraceRecord&, string_view text) {
+            texts.emplace_back(text);
+        }));
+        CHECK(texts.size() == 3);
+        CHECK(texts[0] == "hello");
+        CHECK(texts[1] == string("reader.buffering\0progress", 25));
+        CHECK(texts[2].empty());
+    }
+
+    // 1 writer wraps many times: padding, scan for the oldest record
+    {
+        auto t = fvp::TraceFile::create(path.string().data(), 64 << 10);
+        CHECK(t);
+        string text;
+        for (int64_t n = 0; n < 20000; ++n) {
+            text.assign(size_t(n % 97), 'a'); // variable size to hit padding and scan at different positions
+            t->append(fvp::TraceKind::Log, 4, 0, n, 0, text);
+        }
+    }
+    {
+        const auto data = readFile(path);
+        int errors = 0;
+        size_t count = 0;
+        int64_t last = -1;
+        uint64_t first = 0;
+        uint64_t end = 0;
+        uint64_t bytes = 0;
+        CHECK(fvp::readTrace(data.data(), data.size(), [&](const fvp::TraceRecord& r, string_view text) {
+            if (count++ == 0)
+                first = r.offset;
+            bytes += r.size;
+            // oldest first and no gap
+            if ((last >= 0 && r.values[0] != last + 1) || text != string(size_t(r.values[0] % 97), 'a'))
+                ++errors;
+            last = r.values[0];
+            end = r.offset + r.size;
+        }));
+        CHECK(errors == 0);
+        fvp::TraceFileHeader h;
+        memcpy(&h, data.data(), sizeof(h));
+        CHECK(h.write > 10 * h.capacity);
+        CHECK(last == 19999);
+        CHECK(end == h.write);
+        CHECK(first >= h.write - h.capacity);
+        CHECK(bytes >= h.capacity - 2 * (sizeof(fvp::TraceRecord) + 104)); // lost: the oldest record overwritten partially, and padding
+    }
+
+    // concurrent writers, no record is lost if not wrapped
+    constexpr int kThreads = 4;
+    constexpr int kRecords = 5000;
+    {
+        auto t = fvp::TraceFile::create(path.string().data(), 4 << 20);
+        CHECK(t);
+        vector<thread> writers;
+        for (int i = 0; i < kThreads; ++i) {
+            writers.emplace_back([&, i]{
+                string text;
+                for (int64_t n = 0; n < kRecords; ++n) {
+                    text.assign(size_t(n % 97), 'a' + i);
+                    t->append(fvp::TraceKind::Log, 4, i, n, 0, text);
+                }
+            });
+        }
+        for (auto& w : writers)
+            w.join();
+    }
+    const auto data = readFile(path);
+    vector<int64_t> last(kThreads, -1);
+    int errors = 0;
+    size_t count = 0;
+    CHECK(fvp::readTrace(data.data(), data.size(), [&](const fvp::TraceRecord& r, string_view text) {
+        ++count;
+        const auto i = r.player;
+        if (i < 0 || i >= kThreads || r.values[0] != last[i] + 1 || text != string(size_t(r.values[0] % 97), char('a' + i)))
+            ++errors;
+        else
+            last[i] = r.values[0];
+    }));
+    CHECK(errors == 0);
+    CHECK(count == kThreads * kRecords);
+    filesystem::remove(path);
+    printf("%zu records decoded\n", count);
+    return 0;
+}
@@ -0,0 +1,113 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Decode a trace file written by MdkCallbacksSetTraceFile(), oldest record first.
+// Usage: fvp_trace_dump file [-json]
+#include "trace.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const char* kindName(uint16_t kind)
+{
+    switch (fvp::TraceKind(kind)) {
+    case fvp::TraceKind::Log: return "log";
+    case fvp::TraceKind::Event: return "event";
+    case fvp::TraceKind::State: return "state";
+    case fvp::TraceKind::MediaStatus: return "status";
+    default: return "unknown";
+    }
+}
+
+static const char* levelName(int level)
+{
+    static const char* names[] = { "off", "error", "warning", "info", "debug", "all" };
+    return level >= 0 && level < (int)size(names) ? names[level] : "?";
+}
+
+static string jsonEscape(string_view s)
+{
+    string out;
+    out.reserve(s.size());
+    for (auto c : s) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+    }
+    return out;
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = nullptr;
+    bool json = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-json"))
+            json = true;
+        else if (!path)
+            path = argv[i];
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s file [-json]\n", argv[0]);
+        return 2;
+    }
+    ifstream f(path, ios::binary);
+    const vector<uint8_t> data((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+    int64_t startTime = 0;
+    if (data.size() >= sizeof(fvp::TraceFileHeader))
+        memcpy(&startTime, data.data() + offsetof(fvp::TraceFileHeader, startTime), sizeof(startTime));
+    size_t count = 0;
+    const auto ok = fvp::readTrace(data.data(), data.size(), [&](const fvp::TraceRecord& r, string_view text) {
+        ++count;
+        string_view text2;
+        if (const auto z = text.find('\0'); z != string_view::npos) {
+            text2 = text.substr(z + 1);
+            text = text.substr(0, z);
+        }
+        while (!text.empty() && text.back() == '\n')
+            text.remove_suffix(1);
+        const auto kind = fvp::TraceKind(r.kind);
+        if (json) {
+            printf("{\"time_us\":%lld,\"tid\":%u,\"player\":%lld,\"kind\":\"%s\"", (long long)r.time, r.tid, (long long)r.player, kindName(r.kind));
+            if (kind == fvp::TraceKind::Log)
+                printf(",\"level\":\"%s\",\"text\":\"%s\"}\n", levelName(r.level), jsonEscape(text).data());
+            else if (kind == fvp::TraceKind::Event)
+                printf(",\"error\":%lld,\"category\":\"%s\",\"detail\":\"%s\"}\n", (long long)r.values[0], jsonEscape(text).data(), jsonEscape(text2).data());
+            else
+                printf(",\"old\":%lld,\"new\":%lld}\n", (long long)r.values[0], (long long)r.values[1]);
+            return;
+        }
+        printf("%12.6f %6u %#14llx %-6s ", (r.time - startTime) / 1e6, r.tid, (unsigned long long)r.player, kindName(r.kind));
+        if (kind == fvp::TraceKind::Log)
+            printf("%-7s %.*s\n", levelName(r.level), (int)text.size(), text.data());
+        else if (kind == fvp::TraceKind::Event)
+            printf("%.*s %.*s %lld\n", (int)text.size(), text.data(), (int)text2.size(), text2.data(), (long long)r.values[0]);
+        else
+            printf("%#llx => %#llx\n", (long long)r.values[0], (long long)r.values[1]);
+    });
+    if (!ok) {
+        fprintf(stderr, "%s is not a trace file\n", path);
+        return 1;
+    }
+    if (!json)
+        fprintf(stderr, "%zu records\n", count);
+    return 0;
+}
@@ -0,0 +1 @@
+../../lib/src/bounded_queue.h
\ No newline at end of file
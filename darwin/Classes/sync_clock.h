@@ -0,0 +1 @@
+../../lib/src/sync_clock.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../../lib/src/registry.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../../lib/src/render_target_pool.h
\ No newline at end of file
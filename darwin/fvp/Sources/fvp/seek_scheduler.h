@@ -0,0 +1 @@
+../../../../lib/src/seek_scheduler.h
\ No newline at end of file
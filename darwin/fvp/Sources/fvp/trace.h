@@ -0,0 +1 @@
+../../../../lib/src/trace.h
\ No newline at end of file
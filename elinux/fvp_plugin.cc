@@ -16,6 +16,7 @@
 #include <epoxy/gl.h>
 #include <epoxy/egl.h>
 #endif
+#include <atomic>
 #include <map>
 #include <memory>
 #include <iostream>
@@ -24,6 +25,9 @@
 #include <unordered_map>
 #include "mdk/RenderAPI.h"
 #include "mdk/Player.h"
+#include "../lib/src/render_target_pool.h"
+#include "../lib/src/spans.h"
+#include "../lib/src/stats.h"
 #undef Success // X.h
 
 using namespace std;
@@ -76,11 +80,38 @@ private:
 };
 static thread_local list<shared_ptr<CleanupTask>> gCleanupTasks;
 
+// fbo, texture and the EGLImage sibling of a player, recycled by the pool of egl context after the texture is unregistered
+struct RenderTarget {
+  EGLDisplay disp = EGL_NO_DISPLAY;
+  EGLImageKHR image = EGL_NO_IMAGE_KHR;
+  GLuint tex = 0;
+  GLuint fbo = 0;
+  int width = 0; // allocated size
+  int height = 0;
+};
+using RenderTargetPool = fvp::RenderTargetPool<RenderTarget>;
+
+static void deleteRenderTarget(RenderTarget& rt) // gl context is current
+{
+  static auto eglDestroyImageKHR = (PFNEGLDESTROYIMAGEKHRPROC)eglGetProcAddress("eglDestroyImageKHR");
+  clog << "delete fbo: " + std::to_string(rt.fbo) + " tex: " + std::to_string(rt.tex) << endl;
+  if (rt.image != EGL_NO_IMAGE_KHR)
+    EGL_WARN(eglDestroyImageKHR(rt.disp, rt.image));
+  if (rt.tex)
+    GL_WARN(glDeleteTextures(1, &rt.tex));
+  if (rt.fbo)
+    GL_WARN(glDeleteFramebuffers(1, &rt.fbo));
+  rt = {};
+}
+
 class TexturePlayer final : public mdk::Player
 {
 public:
   TexturePlayer(int64_t handle, int width, int height, flutter::TextureRegistrar* texRegistrar)
     : mdk::Player(reinterpret_cast<mdkPlayerAPI*>(handle))
+    , handle_(handle)
+    , size_(pack(width, height))
+    , stats_(fvp::playerCounters(handle))
     , texture_registrar_(texRegistrar)
   {
     fltImg_->egl_image = EGL_NO_IMAGE_KHR; // TODO:
@@ -91,7 +122,7 @@ public:
     fltImg_->release_context = nullptr; // TODO:
     fltTex_ = make_unique<flutter::TextureVariant>(flutter::EGLImageTexture(
       [this](size_t width, size_t height, void* egl_display, void* egl_context) {
-        fltImg_->egl_image = ensureVideo(width, height, static_cast<EGLDisplay>(egl_display), static_cast<EGLContext>(egl_context));
+        fltImg_->egl_image = ensureVideo(static_cast<EGLDisplay>(egl_display), static_cast<EGLContext>(egl_context));
         return fltImg_.get();
       }
     ));
@@ -101,6 +132,7 @@ public:
     setVideoSurfaceSize(width, height);
     setRenderCallback([this, texRegistrar](void*) {
       //renderVideo(); // need a gl context
+      ++frameSeq_;
       texRegistrar->MarkTextureFrameAvailable(textureId);
     });
   }
@@ -130,53 +162,92 @@ public:
     setVideoSurfaceSize(-1, -1); // no gl context now, but gl resources will be released in raster thread later in ensureVideo()
   }
 
-  EGLImageKHR ensureVideo(size_t width, size_t height, EGLDisplay disp, EGLContext c) {
+  // another render target of the new size is used in the next ensureVideo() in raster thread, texture id is not changed
+  void resize(int width, int height) {
+    size_ = pack(width, height);
+    texture_registrar_->MarkTextureFrameAvailable(textureId);
+  }
+
+  EGLImageKHR ensureVideo(EGLDisplay disp, EGLContext c) {
+    fvp::ScopedSpan span("populate", handle_);
     if (auto count = std::erase_if(gCleanupTasks, [](auto task) { return task->disposed; })) {
       clog << std::to_string(count) + " cleanup tasks executed in raster thread " << this_thread::get_id() << endl;
     }
-    if (fbo_ == 0) {
+    const uint64_t size = size_;
+    const int width = int(size >> 32);
+    const int height = int(size & 0xffffffff);
+    auto& rt = *rt_;
+    auto& retired = *retired_;
+    if (retired.fbo) { // flutter composited the previous frame before requesting a new image
+        RenderTargetPool::of(ctx_, deleteRenderTarget).release(retired.width, retired.height, int64_t(retired.width) * retired.height * 4, retired);
+        retired = {};
+    }
+    if (rt.fbo && (width != rt.width || height != rt.height)) {
+        fvp::ScopedSpan span("resize render targets", handle_);
+        clog << "resize render target from " << rt.width << "x" << rt.height << " to " << width << "x" << height << endl;
+        // flutter may be still compositing the image of the current target, so render into another one and release it in the next call.
+        // the current frame is rendered again in new size, so no black frame
+        retired = rt;
+        rt = {};
+        setVideoSurfaceSize(width, height);
+        rendered_ = 0;
+    }
+    if (rt.fbo == 0) {
         ctx_ = c; // fbo can not be shared
         disp_ = disp;
         draw_ = eglGetCurrentSurface(EGL_DRAW);
         read_ = eglGetCurrentSurface(EGL_READ);
-        GL_WARN(glGenFramebuffers(1, &fbo_));
-        GLint prevFbo = 0;
-        GL_WARN(glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFbo));
-        GL_WARN(glBindFramebuffer(GL_FRAMEBUFFER, fbo_));
-        GL_WARN(glGenTextures(1, &tex_));
-        GL_WARN(glBindTexture(GL_TEXTURE_2D, tex_));
-        GL_WARN(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
-        GL_WARN(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + 0, GL_TEXTURE_2D, tex_, 0));
-        const GLenum err = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-        GL_WARN(glBindFramebuffer(GL_FRAMEBUFFER, prevFbo));
-        if (err != GL_FRAMEBUFFER_COMPLETE) {
-            //glDeleteFramebuffers(1, &fbo);
-            clog << fbo_ << " glFramebufferTexture2D " + std::to_string(tex_) + " error: " << err << endl;
-            return img_;
-        }
-        mdk::GLRenderAPI ra{};
-        ra.fbo = fbo_;
-        setRenderAPI(&ra);
-    }
-    if (img_ == EGL_NO_IMAGE_KHR) {
         if (!eglCreateImageKHR) {
           eglCreateImageKHR = (PFNEGLCREATEIMAGEKHRPROC)eglGetProcAddress("eglCreateImageKHR");
           eglDestroyImageKHR = (PFNEGLDESTROYIMAGEKHRPROC)eglGetProcAddress("eglDestroyImageKHR");
         }
-        EGL_WARN(img_ = eglCreateImageKHR(disp, c, EGL_GL_TEXTURE_2D_KHR, (EGLClientBuffer)(intptr_t)tex_, nullptr));
-        if (img_ == EGL_NO_IMAGE_KHR) {
+        if (auto cached = RenderTargetPool::of(ctx_, deleteRenderTarget).acquire(width, height); cached && cached->disp == disp) {
+            fvp::ScopedSpan span("reuse render targets", handle_);
+            rt = *cached;
+        } else {
+            if (cached) // same context on another display?
+                deleteRenderTarget(*cached);
+            fvp::ScopedSpan span("create render targets", handle_);
+            rt.disp = disp;
+            rt.width = width;
+            rt.height = height;
+            GL_WARN(glGenFramebuffers(1, &rt.fbo));
+            GLint prevFbo = 0;
+            GL_WARN(glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFbo));
+            GL_WARN(glBindFramebuffer(GL_FRAMEBUFFER, rt.fbo));
+            GL_WARN(glGenTextures(1, &rt.tex));
+            GL_WARN(glBindTexture(GL_TEXTURE_2D, rt.tex));
+            GL_WARN(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+            GL_WARN(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + 0, GL_TEXTURE_2D, rt.tex, 0));
+            const GLenum err = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+            GL_WARN(glBindFramebuffer(GL_FRAMEBUFFER, prevFbo));
+            if (err != GL_FRAMEBUFFER_COMPLETE) {
+                //glDeleteFramebuffers(1, &fbo);
+                clog << rt.fbo << " glFramebufferTexture2D " + std::to_string(rt.tex) + " error: " << err << endl;
+                return rt.image;
+            }
+        }
+        fltImg_->width = width;
+        fltImg_->height = height;
+        mdk::GLRenderAPI ra{};
+        ra.fbo = rt.fbo;
+        setRenderAPI(&ra);
+    }
+    if (rt.image == EGL_NO_IMAGE_KHR) {
+        EGL_WARN(rt.image = eglCreateImageKHR(disp, c, EGL_GL_TEXTURE_2D_KHR, (EGLClientBuffer)(intptr_t)rt.tex, nullptr));
+        if (rt.image == EGL_NO_IMAGE_KHR) {
             clog << "eglCreateImageKHR error" << endl;
         }
-        clog << gCleanupTasks.size() << " tasks. created fbo: " + std::to_string(fbo_) + " tex: " + std::to_string(tex_) + " in raster thread " << this_thread::get_id() << endl;
-
-        cleanup_ = [disp = disp_, img = img_, tex = tex_, fbo = fbo_, eglDestroyImageKHR = eglDestroyImageKHR]() { // called in raster thread and gl context is correct
-          clog << "delete fbo: " + std::to_string(fbo) + " tex: " + std::to_string(tex) << endl;
-          if (img != EGL_NO_IMAGE_KHR)
-              EGL_WARN(eglDestroyImageKHR(disp, img));
-          if (tex)
-            GL_WARN(glDeleteTextures(1, &tex));
-          if (fbo)
-            GL_WARN(glDeleteFramebuffers(1, &fbo));
+    }
+    if (!cleanup_) {
+        clog << gCleanupTasks.size() << " tasks. render target fbo: " + std::to_string(rt.fbo) + " tex: " + std::to_string(rt.tex) + " in raster thread " << this_thread::get_id() << endl;
+
+        cleanup_ = [rt = rt_, retired = retired_, ctx = ctx_]() { // called in raster thread and gl context is correct
+          for (auto t : { rt, retired }) {
+            if (t->fbo)
+              RenderTargetPool::of(ctx, deleteRenderTarget).release(t->width, t->height, int64_t(t->width) * t->height * 4, *t);
+            *t = {};
+          }
         };
         if (!unregisterCanPostTask<flutter::TextureRegistrar>()) {
           clog << "incompatible texture_registrar.h, see https://github.com/sony/flutter-embedded-linux/issues/438" << endl;
@@ -186,12 +257,40 @@ public:
         }
     }
 
-    renderVideo();
-    return img_;
+    // flutter repaints for other reasons, reuse the rendered texture if no new frame
+    if (const uint64_t seq = frameSeq_; seq != rendered_) {
+        double timestamp = -1;
+        {
+            fvp::ScopedSpan span("renderVideo", handle_);
+            fvp::ScopedTimer t(stats_->renderCalls, stats_->renderUs);
+            timestamp = renderVideo();
+        }
+        fvp::statusRendered(*stats_, timestamp);
+        fvp::markStartup(*stats_, fvp::FirstRender);
+        rendered_ = seq;
+        stats_->framesPresented++;
+        fvp::markStartup(*stats_, fvp::FirstPresent);
+        if (!firstPresented_) {
+            firstPresented_ = true;
+            fvp::SpanRecorder::instance().record("first frame", handle_, created_, fvp::SpanRecorder::now());
+        }
+    } else {
+        stats_->renderSkipped++;
+    }
+    return rt.image;
   }
 
   int64_t textureId;
 private:
+  static uint64_t pack(int w, int h) { return (uint64_t(uint32_t(w)) << 32) | uint32_t(h); }
+
+  const int64_t handle_;
+  const int64_t created_ = fvp::SpanRecorder::now();
+  atomic<uint64_t> size_; // requested size
+  const shared_ptr<fvp::PlayerCounters> stats_;
+  atomic<uint64_t> frameSeq_ = 1; // increased when mdk requests a redraw, e.g. a new frame is decoded
+  uint64_t rendered_ = 0; // frameSeq_ of the texture content, accessed in raster thread
+  bool firstPresented_ = false;
   unique_ptr<FlutterDesktopEGLImage> fltImg_ = make_unique<FlutterDesktopEGLImage>();
   unique_ptr<flutter::TextureVariant> fltTex_;
   flutter::TextureRegistrar* texture_registrar_ = nullptr;
@@ -204,9 +303,8 @@ private:
   EGLContext ctx_ = EGL_NO_CONTEXT;
   EGLSurface read_ = EGL_NO_SURFACE;
   EGLSurface draw_ = EGL_NO_SURFACE;
-  EGLImageKHR img_ = EGL_NO_IMAGE_KHR;
-  GLuint tex_ = 0; // TODO: array
-  GLuint fbo_ = 0;
+  shared_ptr<RenderTarget> rt_ = make_shared<RenderTarget>(); // shared with cleanup_
+  shared_ptr<RenderTarget> retired_ = make_shared<RenderTarget>(); // the previous target before resizing, shared with cleanup_
 };
 
 
@@ -255,6 +353,7 @@ void FvpPlugin::HandleMethodCall(
       const auto width = (int)args[flutter::EncodableValue("width")].LongValue();
       const auto height = (int)args[flutter::EncodableValue("height")].LongValue();
       const auto handle = args[flutter::EncodableValue("player")].LongValue();
+      fvp::ScopedSpan span("CreateRT", handle);
       auto player = make_shared<TexturePlayer>(handle, width, height, texture_registrar_);
       result->Success(flutter::EncodableValue(player->textureId));
       players_[player->textureId] = player;
@@ -265,6 +364,15 @@ void FvpPlugin::HandleMethodCall(
         players_.erase(it);
     }
     result->Success();
+  } else if (method_call.method_name() == "ResizeRT") {
+    auto args = std::get<flutter::EncodableMap>(*method_call.arguments());
+    const auto texId = args[flutter::EncodableValue("texture")].LongValue();
+    const auto width = (int)args[flutter::EncodableValue("width")].LongValue();
+    const auto height = (int)args[flutter::EncodableValue("height")].LongValue();
+    const auto it = players_.find(texId);
+    if (it != players_.cend())
+      static_pointer_cast<TexturePlayer>(it->second)->resize(width, height);
+    result->Success(flutter::EncodableValue(it != players_.cend()));
   } else if (method_call.method_name() == "MixWithOthers") {
     result->Success();
   } else {
@@ -23,6 +23,8 @@ export 'src/controller.dart';
 ///
 /// 'lowLatency': int. default is 0. reduce network stream latency. 1: for vod. 2: for live stream, may drop frames to ensure the latest content is displayed
 ///
+/// 'logBatchInterval': int, milliseconds. default is 0, every mdk log line is forwarded to dart [Logger] directly. If > 0, lines are queued and delivered in batches, see `setLogForwarding()` in mdk.dart
+///
 /// "player": backend player properties of type [Map<String, String>]. See https://github.com/wang-bin/mdk-sdk/wiki/Player-APIs#void-setpropertyconst-stdstring-key-const-stdstring-value
 ///
 /// "global": backend global options of type [Map<String, Object>]. See https://github.com/wang-bin/mdk-sdk/wiki/Global-Options
@@ -5,3 +5,4 @@
 export 'src/global.dart';
 export 'src/media_info.dart';
 export 'src/player.dart';
+export 'src/player_pool.dart';
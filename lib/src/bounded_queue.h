@@ -0,0 +1,92 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace fvp {
+
+// Lock free bounded multi producer multi consumer queue(Dmitry Vyukov's algorithm). push() fails if full instead of blocking,
+// so it can be used in threads that must not wait, e.g. mdk log handler. Cell values are reused, e.g. a string keeps its capacity.
+template<typename T>
+class BoundedQueue
+{
+public:
+    // capacity is rounded up to a power of 2
+    explicit BoundedQueue(size_t capacity) {
+        size_t n = 2;
+        while (n < capacity)
+            n <<= 1;
+        cells_.reset(new Cell[n]);
+        mask_ = n - 1;
+        for (size_t i = 0; i < n; ++i)
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // fill(T&) writes the value in place. return false if full
+    template<typename F>
+    bool push(F&& fill) {
+        auto pos = enqueue_.load(std::memory_order_relaxed);
+        while (true) {
+            auto& c = cells_[pos & mask_];
+            const auto diff = (intptr_t)c.seq.load(std::memory_order_acquire) - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    fill(c.value);
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // take(T&) reads the value in place. return false if empty
+    template<typename F>
+    bool pop(F&& take) {
+        auto pos = dequeue_.load(std::memory_order_relaxed);
+        while (true) {
+            auto& c = cells_[pos & mask_];
+            const auto diff = (intptr_t)c.seq.load(std::memory_order_acquire) - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (dequeue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    take(c.value);
+                    c.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // approximate
+    size_t size() const {
+        const auto d = dequeue_.load(std::memory_order_relaxed);
+        const auto e = enqueue_.load(std::memory_order_relaxed);
+        return e > d ? e - d : 0;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T value;
+    };
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> enqueue_ = 0;
+    alignas(64) std::atomic<size_t> dequeue_ = 0;
+};
+
+} // namespace fvp
@@ -3,43 +3,657 @@
 // found in the LICENSE file.
 
 #include "mdk/Player.h"
+#include "mdk/VideoFrame.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <initializer_list>
+#include <limits>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <string_view>
 #include <unordered_map>
 #include <iostream>
 #include <thread>
+#include <vector>
 #include "dart_api_types.h"
 #include "callbacks.h"
+#include "bounded_queue.h"
+#include "registry.h"
+#include "render_target_pool.h"
+#include "seek_scheduler.h"
+#include "spans.h"
+#include "stats.h"
+#include "sync_clock.h"
+#include "trace.h"
 #if __has_include("version.h")
 #include "version.h"
 #endif
 
 using namespace std;
 
+static fvp::Registry<fvp::PlayerCounters> counters; // created with Player by MdkCallbacksRegisterPort() only
+
 class Player final: public mdk::Player
 {
 public:
 
     Player(int64_t handle)
         : mdk::Player(reinterpret_cast<mdkPlayerAPI*>(handle))
+        , handle(handle)
+        , stats(counters.getOrCreate(handle))
     {
+        std::fill(std::begin(replyTimeout), std::end(replyTimeout), -1);
+        fallback[CallbackType::MediaStatus].mediaStatus.ret = true;
+        fallback[CallbackType::Prepared].prepared = { .ret = true, .boost = true };
     }
 
-    int callbackTypes = 0;
+    const int64_t handle;
+    const shared_ptr<fvp::PlayerCounters> stats;
+    atomic<int> callbackTypes = 0;
+    atomic<int> packedTypes = 0; // posted as packed messages
+    atomic<uint32_t> packedSeq = 0;
     bool reply[int(CallbackType::Count)] = {};
-    bool dataReady[int(CallbackType::Count)] = {};
     CallbackReply data[int(CallbackType::Count)];
+    // replies are in the same order as requests
+    int64_t requested[int(CallbackType::Count)] = {};
+    int64_t replied[int(CallbackType::Count)] = {};
+    ReplyMode replyMode[int(CallbackType::Count)] = {};
+    int replyTimeout[int(CallbackType::Count)]; // ms
+    CallbackReply fallback[int(CallbackType::Count)] = {};
+    deque<pair<int64_t, chrono::steady_clock::time_point>> deadlines[int(CallbackType::Count)]; // async requests
+    // prepare, seek and snapshot operations. ids are unique in a player, and increasing
+    atomic<int64_t> ops = 0;
+    atomic<int64_t> latestOps[int(CallbackType::Count)] = {}; // e.g. a newer prepare cancels older ones
+    atomic<int64_t> cancelledOps[int(CallbackType::Count)] = {}; // ops <= value are cancelled by MdkCancel()
+    atomic<int64_t> preparedGen = 0; // prepare result of the op is known by mdk
+    // control calls(prepare, seek, state, media) in call order. not empty only if running
+    struct Command {
+        function<void()> run;
+        bool blocking; // may wait for mdk, never run in the caller thread
+    };
+    mutex commandMtx;
+    deque<Command> commands;
+    bool commandsRunning = false;
+    int tasks = 0; // running or queued worker tasks using mdk player, e.g. reissued seeks
+    bool closed = false; // unregistered, no more commands and tasks
+    condition_variable commandsIdle; // no command and task
+    fvp::SeekScheduler seeks{stats->seeksElided};
+    const shared_ptr<fvp::SyncClock> syncClock = make_shared<fvp::SyncClock>(); // captured by mdk sync callback
     mutex mtx[int(CallbackType::Count)];
     condition_variable cv[int(CallbackType::Count)];
 
     mdk::State oldState = mdk::State::Stopped;
+
+    int64_t beginOp(CallbackType type) {
+        const auto op = ++ops;
+        latestOps[int(type)] = op;
+        return op;
+    }
+    int64_t latestOp(CallbackType type) const { return latestOps[int(type)]; }
+    bool cancelled(CallbackType type, int64_t op) const { return op <= cancelledOps[int(type)]; }
+    // older or cancelled
+    bool abandoned(CallbackType type, int64_t op) const { return op != latestOp(type) || cancelled(type, op); }
+
+    // event ring. writers(mdk threads) are serialized by ringMtx, dart is the only reader
+    unique_ptr<CallbackRecord[]> ringData;
+    atomic<CallbackRecord*> ring = nullptr;
+    int ringSize = 0;
+    atomic<int64_t> ringWrite = 0;
+    atomic<int64_t> ringRead = 0;
+    atomic<bool> ringWakePending = false;
+    mutex ringMtx; // held to copy a record only
+
+    struct Coalescing {
+        chrono::milliseconds interval;
+        chrono::steady_clock::time_point posted;
+        bool pending = false;
+        mdk::MediaEvent latest;
+    };
+    atomic<bool> coalescing = false;
+    mutex coalesceMtx;
+    unordered_map<string, Coalescing> coalesce; // by event category
 };
 
-static unordered_map<int64_t, shared_ptr<Player>> players;
+static fvp::Registry<Player> players;
+
+namespace fvp {
+shared_ptr<PlayerCounters> playerCounters(int64_t handle)
+{
+    if (auto c = counters.get(handle))
+        return c;
+    auto c = make_shared<PlayerCounters>();
+    c->registered = false;
+    return c;
+}
+
+void removePlayerCounters(int64_t handle)
+{
+    if (auto c = counters.take(handle))
+        c->registered = false;
+}
+
+StartupHistogram& startupHistogram()
+{
+    static auto h = new StartupHistogram();
+    return *h;
+}
+
+atomic<int64_t>& renderTargetPoolLimit()
+{
+    static atomic<int64_t> limit = 128 << 20;
+    return limit;
+}
+} // namespace fvp
+
+// post a message of player and update stats
+static bool post(fvp::PlayerCounters& stats, Dart_PostCObject postCObject, Dart_Port send_port, Dart_CObject* msg)
+{
+    fvp::ScopedSpan span("postCObject");
+    if (!postCObject(send_port, msg)) {
+        stats.postErrors.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+    stats.eventsPosted.fetch_add(1, memory_order_relaxed);
+    return true;
+}
 
 // global callbacks
 static int gCallbackTypes = 0;
+static atomic<int> gPackedTypes = 0;
+static atomic<uint32_t> gPackedSeq = 0;
+
+// post 1 Uint8List instead of an array of objects, layout is documented in callbacks.h. stats is null for global callbacks
+static bool postPacked(fvp::PlayerCounters* stats, Dart_PostCObject postCObject, Dart_Port send_port, int type, uint32_t seq, initializer_list<int64_t> values, string_view text = {})
+{
+    uint8_t stack[256]; // enough except long logs
+    thread_local vector<uint8_t> heap;
+    const auto size = 16 + values.size() * 8 + text.size();
+    auto data = stack;
+    if (size > sizeof(stack)) {
+        heap.resize(size);
+        data = heap.data();
+    }
+    auto out = data;
+    const auto put = [&out](uint64_t v, int bytes) {
+        for (int i = 0; i < bytes; ++i)
+            *out++ = uint8_t(v >> (8 * i));
+    };
+    put((uint32_t)type, 4);
+    put(seq, 4);
+    put(chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count(), 8);
+    for (auto v : values)
+        put(v, 8);
+    memcpy(out, text.data(), text.size());
+    Dart_CObject msg{
+        .type = Dart_CObject_kTypedData,
+        .value = {
+            .as_typed_data = {
+                .type = Dart_TypedData_kUint8,
+                .length = (intptr_t)size,
+                .values = data,
+            },
+        }
+    };
+    if (stats)
+        return post(*stats, postCObject, send_port, &msg);
+    return postCObject(send_port, &msg);
+}
+
+// post [type, values...] as an array or a packed message
+static bool postValues(Player* p, Dart_PostCObject postCObject, Dart_Port send_port, int type, initializer_list<int64_t> values)
+{
+    if (p->packedTypes.load(memory_order_relaxed) & (1 << type))
+        return postPacked(p->stats.get(), postCObject, send_port, type, p->packedSeq++, values);
+    Dart_CObject objs[3] = {
+        {
+            .type = Dart_CObject_kInt64,
+            .value = {
+                .as_int64 = type,
+            }
+        },
+    };
+    Dart_CObject* arr[std::size(objs)] = { &objs[0] };
+    int n = 1;
+    for (auto v : values) {
+        objs[n] = Dart_CObject{
+            .type = Dart_CObject_kInt64,
+            .value = {
+                .as_int64 = v,
+            }
+        };
+        arr[n] = &objs[n];
+        ++n;
+    }
+    Dart_CObject msg {
+        .type = Dart_CObject_kArray,
+        .value = {
+            .as_array = {
+                .length = n,
+                .values = arr,
+            },
+        }
+    };
+    return post(*p->stats, postCObject, send_port, &msg);
+}
+
+struct LogView {
+    int level;
+    string_view text; // null terminated
+};
+
+// post log lines in 1 message. array: [Log, level0, text0, level1, text1, ...]
+static bool postLogs(Dart_PostCObject postCObject, Dart_Port send_port, const LogView* lines, size_t count)
+{
+    const auto type = int(CallbackType::Log);
+    if (gPackedTypes.load(memory_order_relaxed) & (1 << type)) {
+        thread_local string payload;
+        payload.clear();
+        for (size_t i = 0; i < count; ++i) {
+            const auto& l = lines[i];
+            for (auto v : { (uint32_t)l.level, (uint32_t)l.text.size() }) {
+                for (int b = 0; b < 4; ++b)
+                    payload.push_back(char(v >> (8 * b)));
+            }
+            payload.append(l.text);
+        }
+        return postPacked(nullptr, postCObject, send_port, type, gPackedSeq++, {}, payload);
+    }
+    vector<Dart_CObject> objs(1 + 2 * count);
+    vector<Dart_CObject*> arr(objs.size());
+    objs[0] = Dart_CObject{
+        .type = Dart_CObject_kInt64,
+        .value = {
+            .as_int64 = type,
+        }
+    };
+    for (size_t i = 0; i < count; ++i) {
+        objs[1 + 2 * i] = Dart_CObject{
+            .type = Dart_CObject_kInt64,
+            .value = {
+                .as_int64 = lines[i].level,
+            }
+        };
+        objs[2 + 2 * i] = Dart_CObject{
+            .type = Dart_CObject_kString,
+            .value = {
+                .as_string = lines[i].text.data(),
+            }
+        };
+    }
+    for (size_t i = 0; i < objs.size(); ++i)
+        arr[i] = &objs[i];
+    Dart_CObject msg {
+        .type = Dart_CObject_kArray,
+        .value = {
+            .as_array = {
+                .length = (intptr_t)arr.size(),
+                .values = arr.data(),
+            },
+        },
+    };
+    return postCObject(send_port, &msg);
+}
+
+// Filter mdk logs by level in the logging thread, then post them directly, or queue them to be posted in batches by a dedicated thread,
+// so verbose logs neither flood the isolate nor block mdk threads. Intentionally leaked because mdk can log on exit
+class LogForwarder
+{
+public:
+    static LogForwarder& instance() {
+        static auto f = new LogForwarder();
+        return *f;
+    }
+
+    void setPort(Dart_PostCObject postCObject, Dart_Port send_port) {
+        post_ = postCObject;
+        port_ = send_port;
+    }
+
+    // queue capacity is used when batching is enabled the first time
+    void configure(int level, int intervalMs, int capacity) {
+        level_ = level;
+        if (intervalMs > 0 && !queue_.load(memory_order_acquire)) {
+            queue_.store(new fvp::BoundedQueue<LogLine>(std::max(capacity, 16)), memory_order_release);
+            thread(&LogForwarder::run, this).detach();
+        }
+        interval_ = intervalMs;
+        cv_.notify_one(); // flush lines queued with the old interval
+    }
+
+    void log(mdk::LogLevel level, const char* msg) {
+        if ((int)level > level_.load(memory_order_relaxed) || !post_.load(memory_order_relaxed))
+            return;
+        const auto q = queue_.load(memory_order_acquire);
+        if (q && interval_.load(memory_order_relaxed) > 0) {
+            if (!q->push([&](LogLine& l) {
+                    l.level = (int)level;
+                    l.text.assign(msg);
+                })) {
+                dropped_.fetch_add(1, memory_order_relaxed);
+            } else if (q->size() >= q->capacity() / 2) {
+                cv_.notify_one(); // notify w/o lock, a missed wakeup is bounded by interval
+            }
+            return;
+        }
+        const LogView v{ (int)level, msg };
+        if (!postLogs(post_, port_, &v, 1))
+            cout << __func__ << "postCObject error" << endl; // clog: dead log. why post error?
+    }
+
+    int64_t dropped() const { return dropped_.load(memory_order_relaxed); }
+
+private:
+    struct LogLine {
+        int level;
+        string text;
+    };
+
+    void run() {
+        const auto q = queue_.load(memory_order_acquire);
+        vector<LogLine> lines(q->capacity() + 1); // +1: dropped lines report
+        vector<LogView> views;
+        views.reserve(lines.size());
+        string note;
+        int64_t reported = 0;
+        unique_lock lock(mtx_);
+        while (true) {
+            const auto interval = interval_.load(memory_order_relaxed);
+            cv_.wait_for(lock, chrono::milliseconds(interval > 0 ? interval : 1000));
+            size_t n = 0;
+            while (n < lines.size() - 1 && q->pop([&](LogLine& l) { swap(lines[n], l); })) // swap: strings keep capacity
+                ++n;
+            views.clear();
+            for (size_t i = 0; i < n; ++i)
+                views.push_back({ lines[i].level, lines[i].text });
+            if (const auto d = dropped(); d > reported) {
+                note = "fvp: " + to_string(d - reported) + " log lines dropped";
+                views.push_back({ (int)mdk::LogLevel::Warning, note });
+                reported = d;
+            }
+            if (views.empty())
+                continue;
+            if (!postLogs(post_, port_, views.data(), views.size()))
+                cout << __func__ << "postCObject error" << endl;
+        }
+    }
+
+    atomic<Dart_PostCObject> post_ = nullptr;
+    atomic<Dart_Port> port_ = 0;
+    atomic<int> level_ = (int)mdk::LogLevel::All;
+    atomic<int> interval_ = 0;
+    atomic<int64_t> dropped_ = 0;
+    atomic<fvp::BoundedQueue<LogLine>*> queue_ = nullptr;
+    mutex mtx_;
+    condition_variable cv_;
+};
+
+static atomic<fvp::TraceFile*> gTrace = nullptr;
+// trace() calls using gTrace, counted by parity of the epoch increased when gTrace is replaced. the replaced file is unmapped when writers
+// of the previous epoch return, new writers are counted in the new epoch so they never delay it
+static atomic<uint32_t> gTraceEpoch = 0;
+static atomic<int> gTraceWriters[2] = {};
+static atomic<bool> gLogPort = false; // global port is registered, logs can be forwarded to dart
+
+static void trace(fvp::TraceKind kind, int level, int64_t player, int64_t v0, int64_t v1 = 0, string_view text = {}, string_view text2 = {})
+{
+    if (!gTrace.load(memory_order_relaxed))
+        return;
+    uint32_t e = 0;
+    while (true) { // seq_cst with MdkCallbacksSetTraceFile(). counted in the epoch of the loaded file, or in a newer one
+        e = gTraceEpoch.load();
+        gTraceWriters[e & 1].fetch_add(1);
+        if (gTraceEpoch.load() == e)
+            break;
+        gTraceWriters[e & 1].fetch_sub(1);
+    }
+    if (const auto t = gTrace.load())
+        t->append(kind, level, player, v0, v1, text, text2);
+    gTraceWriters[e & 1].fetch_sub(1, memory_order_release);
+}
+
+static void onLog(mdk::LogLevel level, const char* msg)
+{
+    trace(fvp::TraceKind::Log, (int)level, 0, 0, 0, msg);
+    if (!(gCallbackTypes & (1 << CallbackType::Log)))
+        return;
+    LogForwarder::instance().log(level, msg);
+}
+
+// onLog is the mdk log handler if logs are forwarded to dart or traced, otherwise mdk default handler is restored
+static void updateLogHandler()
+{
+    static mutex mtx;
+    scoped_lock lock(mtx);
+    mdk::setLogHandler(gLogPort || gTrace.load() ? onLog : nullptr);
+}
+
+static void appendText(CallbackRecord& rec, const string& s, bool first = false)
+{
+    if (!first && rec.size < (int)sizeof(rec.text))
+        rec.text[rec.size++] = 0;
+    const auto n = std::min(s.size(), sizeof(rec.text) - rec.size);
+    memcpy(rec.text + rec.size, s.data(), n);
+    rec.size += (int)n;
+}
+
+// return false if ring is not enabled, then the event should be posted as a message
+static bool pushRecord(Player* p, const CallbackRecord& rec, Dart_PostCObject postCObject, Dart_Port send_port)
+{
+    const auto ring = p->ring.load(memory_order_acquire);
+    if (!ring)
+        return false;
+    bool full = false;
+    {
+        scoped_lock lock(p->ringMtx);
+        const auto w = p->ringWrite.load(memory_order_relaxed);
+        full = w - p->ringRead.load(memory_order_acquire) >= p->ringSize;
+        if (!full) {
+            ring[w % p->ringSize] = rec;
+            p->ringWrite.store(w + 1, memory_order_release);
+        }
+    }
+    if (full) {
+        if (p->stats->eventsDropped++ == 0)
+            clog << "callback ring is full, drop events" << endl;
+        return true;
+    }
+    p->stats->eventsPosted.fetch_add(1, memory_order_relaxed);
+    // at most 1 wake message in flight. dart clears the flag before reading write index, so no record is missed
+    if (p->ringWakePending.exchange(true))
+        return true;
+    Dart_CObject t{
+        .type = Dart_CObject_kInt64,
+        .value = {
+            .as_int64 = CallbackType::Ring,
+        }
+    };
+    Dart_CObject* arr[] = { &t };
+    Dart_CObject msg {
+        .type = Dart_CObject_kArray,
+        .value = {
+            .as_array = {
+                .length = std::size(arr),
+                .values = arr,
+            },
+        },
+    };
+    if (!postCObject(send_port, &msg)) {
+        clog << __func__ << __LINE__ << " postCObject error" << endl;
+        p->stats->postErrors.fetch_add(1, memory_order_relaxed);
+        p->ringWakePending = false;
+    }
+    return true;
+}
+
+static void postEvent(Player* p, const mdk::MediaEvent& e, Dart_PostCObject postCObject, Dart_Port send_port)
+{
+    const auto type = int(CallbackType::Event);
+    if (p->ring.load(memory_order_relaxed)) {
+        CallbackRecord rec{
+            .type = type,
+            .size = 0,
+            .values = { e.error },
+            .text = {},
+        };
+        appendText(rec, e.category, true);
+        appendText(rec, e.detail);
+        if (pushRecord(p, rec, postCObject, send_port))
+            return;
+    }
+    Dart_CObject t{
+        .type = Dart_CObject_kInt64,
+        .value = {
+            .as_int64 = type,
+        }
+    };
+    Dart_CObject err{
+        .type = Dart_CObject_kInt64,
+        .value = {
+            .as_int64 = (int64_t)e.error,
+        }
+    };
+    Dart_CObject cat{
+        .type = Dart_CObject_kString,
+        .value = {
+            .as_string = e.category.data(),
+        }
+    };
+    Dart_CObject detail{
+        .type = Dart_CObject_kString,
+        .value = {
+            .as_string = e.detail.data(),
+        }
+    };
+    Dart_CObject* arr[] = { &t, &err, &cat, &detail };
+    Dart_CObject msg {
+        .type = Dart_CObject_kArray,
+        .value = {
+            .as_array = {
+                .length = std::size(arr),
+                .values = arr,
+            },
+        },
+    };
+    if (!post(*p->stats, postCObject, send_port, &msg)) {
+        clog << __func__ << __LINE__ << " postCObject error" << endl;
+    }
+}
+
+// lock is held since the message is posted. return true if dart replied in time
+static bool waitReply(Player* p, int type, unique_lock<mutex>& lock)
+{
+    const auto seq = ++p->requested[type];
+    const auto timeout = p->replyTimeout[type];
+    if (p->replyMode[type] == ReplyAsync) { // dart decision will be applied when reply arrives
+        p->deadlines[type].emplace_back(seq, timeout < 0 ? chrono::steady_clock::time_point::max() : chrono::steady_clock::now() + chrono::milliseconds(timeout));
+        return false;
+    }
+    const auto ready = [=]{
+        return p->replied[type] >= seq || !(p->callbackTypes & (1 << type));
+    };
+    static const char* spanNames[] = { "wait Event reply", "wait State reply", "wait MediaStatus reply", "wait Prepared reply", "wait Sync reply" };
+    fvp::ScopedSpan span(type < (int)std::size(spanNames) ? spanNames[type] : "wait reply", p->handle);
+    fvp::ScopedTimer t(p->stats->replyWaits, p->stats->replyWaitUs);
+    if (timeout < 0)
+        p->cv[type].wait(lock, ready);
+    else
+        p->cv[type].wait_for(lock, chrono::milliseconds(timeout), ready);
+    return p->replied[type] >= seq;
+}
+
+// run delayed tasks in 1 thread. intentionally leaked because it can be used by mdk threads on exit
+class TimerQueue
+{
+public:
+    static TimerQueue& instance() {
+        static auto q = new TimerQueue();
+        return *q;
+    }
+
+    void post(chrono::steady_clock::time_point t, function<void()>&& f) {
+        scoped_lock lock(mtx_);
+        if (!started_) {
+            thread([this]{ run(); }).detach();
+            started_ = true;
+        }
+        tasks_.emplace(t, std::move(f));
+        cv_.notify_one();
+    }
+
+private:
+    void run() {
+        unique_lock lock(mtx_);
+        while (true) {
+            if (tasks_.empty()) {
+                cv_.wait(lock);
+                continue;
+            }
+            const auto it = tasks_.begin();
+            if (it->first > chrono::steady_clock::now()) {
+                cv_.wait_until(lock, it->first);
+                continue;
+            }
+            auto f = std::move(it->second);
+            tasks_.erase(it);
+            lock.unlock();
+            f();
+            lock.lock();
+        }
+    }
+
+    mutex mtx_;
+    condition_variable cv_;
+    multimap<chrono::steady_clock::time_point, function<void()>> tasks_;
+    bool started_ = false;
+};
+
+// deliver the latest event of a coalesced category at most once per interval
+static void coalesceEvent(const shared_ptr<Player>& sp, const mdk::MediaEvent& e, Dart_PostCObject postCObject, Dart_Port send_port)
+{
+    auto p = sp.get();
+    unique_lock lock(p->coalesceMtx);
+    const auto it = p->coalesce.find(e.category);
+    if (it == p->coalesce.end()) {
+        lock.unlock();
+        postEvent(p, e, postCObject, send_port);
+        return;
+    }
+    auto& c = it->second;
+    const auto now = chrono::steady_clock::now();
+    if (!c.pending && now - c.posted >= c.interval) {
+        c.posted = now;
+        lock.unlock();
+        postEvent(p, e, postCObject, send_port);
+        return;
+    }
+    const auto scheduled = c.pending;
+    c.pending = true;
+    c.latest = e;
+    if (scheduled)
+        return;
+    TimerQueue::instance().post(c.posted + c.interval, [wp = weak_ptr<Player>(sp), category = e.category, postCObject, send_port]{
+        auto sp = wp.lock();
+        if (!sp)
+            return;
+        auto p = sp.get();
+        unique_lock lock(p->coalesceMtx);
+        const auto it = p->coalesce.find(category);
+        if (it == p->coalesce.end() || !it->second.pending)
+            return;
+        auto& c = it->second;
+        c.pending = false;
+        c.posted = chrono::steady_clock::now();
+        const auto e = std::move(c.latest);
+        lock.unlock();
+        postEvent(p, e, postCObject, send_port);
+    });
+}
 
 FVP_EXPORT
 #if (__clang__ + 0)
@@ -57,50 +671,16 @@ FVP_EXPORT void MdkCallbacksRegisterPort(int64_t handle, void* post_c_object, in
 {
     const auto postCObject = reinterpret_cast<bool(*)(Dart_Port, Dart_CObject*)>(post_c_object);
     if (!handle) { // global callbacks
-        mdk::setLogHandler([=](mdk::LogLevel level, const char* logMsg){
-            const auto type = int(CallbackType::Log);
-            if (!(gCallbackTypes & (1 << type)))
-                return;
-            Dart_CObject t{
-                .type = Dart_CObject_kInt64,
-                .value = {
-                    .as_int64 = type,
-                }
-            };
-            Dart_CObject lv{
-                .type = Dart_CObject_kInt64,
-                .value = {
-                    .as_int64 = (int64_t)level,
-                }
-            };
-            Dart_CObject txt{
-                .type = Dart_CObject_kString,
-                .value = {
-                    .as_string = logMsg,
-                }
-            };
-            Dart_CObject* arr[] = { &t, &lv, &txt };
-            Dart_CObject msg {
-                .type = Dart_CObject_kArray,
-                .value = {
-                    .as_array = {
-                        .length = std::size(arr),
-                        .values = arr,
-                    },
-                },
-            };
-            if (!postCObject(send_port, &msg)) {
-                cout << __func__ << "postCObject error" << endl; // clog: dead log. why post error?
-                return;
-            }
-        });
+        LogForwarder::instance().setPort(postCObject, send_port);
+        gLogPort = true;
+        updateLogHandler();
 #ifdef FVP_VERSION
         clog << "fvp plugin version: " FVP_VERSION << endl;
 #endif
         return;
     }
     auto player = make_shared<Player>(handle);
-    players[handle] = player;
+    players.set(handle, player);
     const auto tid = this_thread::get_id();
 
     auto wp = weak_ptr<Player>(player);
@@ -109,50 +689,32 @@ FVP_EXPORT void MdkCallbacksRegisterPort(int64_t handle, void* post_c_object, in
         if (!sp)
             return false;
         auto p = sp.get();
+        trace(fvp::TraceKind::Event, 0, handle, e.error, 0, e.category, e.detail);
+        if (e.error == 0 && e.category == "decoder.video")
+            fvp::markStartup(*p->stats, fvp::VideoDecoder);
+        if (e.category == "reader.buffering") {
+            const auto buffered = p->buffered();
+            fvp::StatusWriter s(*p->stats);
+            s->buffered.store(buffered, memory_order_relaxed);
+        }
         const auto type = int(CallbackType::Event);
         if (!(p->callbackTypes & (1 << type)))
             return false;
-        Dart_CObject t{
-            .type = Dart_CObject_kInt64,
-            .value = {
-                .as_int64 = type,
-            }
-        };
-        Dart_CObject err{
-            .type = Dart_CObject_kInt64,
-            .value = {
-                .as_int64 = (int64_t)e.error,
-            }
-        };
-        Dart_CObject cat{
-            .type = Dart_CObject_kString,
-            .value = {
-                .as_string = e.category.data(),
-            }
-        };
-        Dart_CObject detail{
-            .type = Dart_CObject_kString,
-            .value = {
-                .as_string = e.detail.data(),
-            }
-        };
-        Dart_CObject* arr[] = { &t, &err, &cat, &detail };
-        Dart_CObject msg {
-            .type = Dart_CObject_kArray,
-            .value = {
-                .as_array = {
-                    .length = std::size(arr),
-                    .values = arr,
-                },
-            },
-        };
-        if (!postCObject(send_port, &msg)) {
-            clog << __func__ << __LINE__ << " postCObject error" << endl;
+        if (!p->coalescing.load(memory_order_relaxed)) {
+            postEvent(p, e, postCObject, send_port);
             return false;
         }
+        coalesceEvent(sp, e, postCObject, send_port);
         return false;
     });
 
+    // position of status on all platforms. frames are not changed
+    player->onFrame<mdk::VideoFrame>([stats = player->stats](mdk::VideoFrame& v, int) {
+        if (v && v.timestamp() < numeric_limits<double>::max()) // not TimestampEOS
+            fvp::statusFrame(*stats, v.timestamp());
+        return 0;
+    });
+
     player->onStateChanged([=](mdk::State s){
         auto sp = wp.lock();
         if (!sp)
@@ -161,41 +723,29 @@ FVP_EXPORT void MdkCallbacksRegisterPort(int64_t handle, void* post_c_object, in
         const auto type = int(CallbackType::State);
         const auto oldValue = p->oldState;
         p->oldState = s;
+        trace(fvp::TraceKind::State, 0, handle, (int64_t)oldValue, (int64_t)s);
+        const auto position = p->position();
+        {
+            fvp::StatusWriter w(*p->stats);
+            w->state.store(int32_t(s), memory_order_relaxed);
+            w->position.store(position, memory_order_relaxed);
+        }
         if (!(p->callbackTypes & (1 << type)))
             return;
+        if (!p->reply[type]) {
+            CallbackRecord rec{
+                .type = type,
+                .size = 0,
+                .values = { (int64_t)oldValue, (int64_t)s },
+                .text = {},
+            };
+            if (pushRecord(p, rec, postCObject, send_port))
+                return;
+        }
 
         unique_lock lock(p->mtx[type]);
-        p->dataReady[type] = false;
 
-        Dart_CObject t{
-            .type = Dart_CObject_kInt64,
-            .value = {
-                .as_int64 = type,
-            }
-        };
-        Dart_CObject v0{
-            .type = Dart_CObject_kInt64,
-            .value = {
-                .as_int64 = (int64_t)oldValue,
-            }
-        };
-        Dart_CObject v1{
-            .type = Dart_CObject_kInt64,
-            .value = {
-                .as_int64 = (int64_t)s,
-            }
-        };
-        Dart_CObject* arr[] = { &t, &v0, &v1 };
-        Dart_CObject msg {
-            .type = Dart_CObject_kArray,
-            .value = {
-                .as_array = {
-                    .length = std::size(arr),
-                    .values = arr,
-                },
-            }
-        };
-        if (!postCObject(send_port, &msg)) {
+        if (!postValues(p, postCObject, send_port, type, { (int64_t)oldValue, (int64_t)s })) {
             clog << __func__ << __LINE__ << " postCObject error" << endl;
             return;
         }
@@ -205,9 +755,7 @@ FVP_EXPORT void MdkCallbacksRegisterPort(int64_t handle, void* post_c_object, in
             clog << "main thread. won't wait callback" << endl;
             return;
         }
-        p->cv[type].wait(lock, [=]{
-            return p->dataReady[type] || !(p->callbackTypes & (1 << type));
-        });
+        waitReply(p, type, lock);
     });
 
     player->onMediaStatus([=](mdk::MediaStatus oldValue, mdk::MediaStatus newValue){
@@ -215,42 +763,30 @@ FVP_EXPORT void MdkCallbacksRegisterPort(int64_t handle, void* post_c_object, in
         if (!sp)
             return false;
         auto p = sp.get();
+        trace(fvp::TraceKind::MediaStatus, 0, handle, (int64_t)oldValue, (int64_t)newValue);
+        const auto buffered = p->buffered();
+        {
+            fvp::StatusWriter s(*p->stats);
+            s->mediaStatus.store(int32_t(newValue), memory_order_relaxed);
+            s->buffered.store(buffered, memory_order_relaxed);
+        }
         const auto type = int(CallbackType::MediaStatus);
         if (!(p->callbackTypes & (1 << type)))
             return true;
+        if (!p->reply[type]) {
+            CallbackRecord rec{
+                .type = type,
+                .size = 0,
+                .values = { (int64_t)oldValue, (int64_t)newValue },
+                .text = {},
+            };
+            if (pushRecord(p, rec, postCObject, send_port))
+                return true;
+        }
 
         unique_lock lock(p->mtx[type]);
-        p->dataReady[type] = false;
 
-        Dart_CObject t{
-            .type = Dart_CObject_kInt64,
-            .value = {
-                .as_int64 = type,
-            }
-        };
-        Dart_CObject v0{
-            .type = Dart_CObject_kInt64,
-            .value = {
-                .as_int64 = (int64_t)oldValue,
-            }
-        };
-        Dart_CObject v1{
-            .type = Dart_CObject_kInt64,
-            .value = {
-                .as_int64 = (int64_t)newValue,
-            }
-        };
-        Dart_CObject* arr[] = { &t, &v0, &v1 };
-        Dart_CObject msg {
-            .type = Dart_CObject_kArray,
-            .value = {
-                .as_array = {
-                    .length = std::size(arr),
-                    .values = arr,
-                },
-            }
-        };
-        if (!postCObject(send_port, &msg)) {
+        if (!postValues(p, postCObject, send_port, type, { (int64_t)oldValue, (int64_t)newValue })) {
             clog << __func__ << __LINE__ << "postCObject error" << endl;
             return true;
         }
@@ -260,9 +796,8 @@ FVP_EXPORT void MdkCallbacksRegisterPort(int64_t handle, void* post_c_object, in
             clog << "main thread. won't wait callback" << endl;
             return true;
         }
-        p->cv[type].wait(lock, [=]{
-            return p->dataReady[type] || !(p->callbackTypes & (1 << type));
-        });
+        if (!waitReply(p, type, lock))
+            return p->fallback[type].mediaStatus.ret;
         return p->data[type].mediaStatus.ret;
     });
 
@@ -274,6 +809,20 @@ FVP_EXPORT void MdkCallbacksRegisterPort(int64_t handle, void* post_c_object, in
         const auto type = int(CallbackType::SubtitleText);
         if (!(p->callbackTypes & (1 << type)))
             return;
+        if (p->ring.load(memory_order_relaxed)) {
+            CallbackRecord rec{
+                .type = type,
+                .size = 0,
+                .values = {},
+                .text = {},
+            };
+            memcpy(&rec.values[0], &start, sizeof(start));
+            memcpy(&rec.values[1], &end, sizeof(end));
+            for (size_t i = 0; i < texts.size(); ++i)
+                appendText(rec, texts[i], i == 0);
+            if (pushRecord(p, rec, postCObject, send_port))
+                return;
+        }
 
         Dart_CObject t{
             .type = Dart_CObject_kInt64,
@@ -326,7 +875,7 @@ FVP_EXPORT void MdkCallbacksRegisterPort(int64_t handle, void* post_c_object, in
                 },
             }
         };
-        if (!postCObject(send_port, &msg)) {
+        if (!post(*p->stats, postCObject, send_port, &msg)) {
             clog << __func__ << __LINE__ << "postCObject error" << endl;
             return;
         }
@@ -337,22 +886,29 @@ FVP_EXPORT void MdkCallbacksRegisterPort(int64_t handle, void* post_c_object, in
 FVP_EXPORT void MdkCallbacksUnregisterPort(int64_t handle)
 {
     if (!handle) {
-        mdk::setLogHandler(nullptr);
+        gLogPort = false;
+        updateLogHandler();
         return;
     }
 
-    const auto it = players.find(handle);
-    if (it == players.cend()) {
+    auto sp = players.take(handle);
+    fvp::removePlayerCounters(handle);
+    if (!sp) {
         return;
     }
-
-    auto sp = it->second;
+    // pending prepare, seek and snapshot ops are cancelled, and mdk callbacks waiting for dart replies return
+    for (auto& cancelled : sp->cancelledOps)
+        cancelled = sp->ops.load();
+    sp->seeks.reset();
+    sp->callbackTypes = 0;
     for (int i = 0; i < (int)CallbackType::Count; ++i) {
         unique_lock lock(sp->mtx[i]);
-        sp->cv[i].notify_one();
+        sp->cv[i].notify_all();
     }
-
-    players.erase(it);
+    // queued control calls and worker tasks use mdk player which is deleted by dart after return
+    unique_lock lock(sp->commandMtx);
+    sp->closed = true;
+    sp->commandsIdle.wait(lock, [&]{ return !sp->commandsRunning && sp->tasks == 0; });
 }
 
 FVP_EXPORT void MdkCallbacksRegisterType(int64_t handle, int type, bool reply)
@@ -362,12 +918,11 @@ FVP_EXPORT void MdkCallbacksRegisterType(int64_t handle, int type, bool reply)
         return;
     }
 
-    const auto it = players.find(handle);
-    if (it == players.cend()) {
+    auto sp = players.get(handle);
+    if (!sp) {
         return;
     }
 
-    auto sp = it->second;
     sp->callbackTypes |= (1 << type);
     sp->reply[type] = reply;
 }
@@ -379,189 +934,1143 @@ FVP_EXPORT void MdkCallbacksUnregisterType(int64_t handle, int type)
         return;
     }
 
-    const auto it = players.find(handle);
-    if (it == players.cend()) {
+    auto sp = players.get(handle);
+    if (!sp) {
         return;
     }
 
-    auto sp = it->second;
     sp->callbackTypes &= ~(1 << type);
 }
 
 FVP_EXPORT void MdkCallbacksReplyType(int64_t handle, int type, const void* data)
 {
-    const auto it = players.find(handle);
-    if (it == players.cend()) {
+    auto sp = players.get(handle);
+    if (!sp) {
         return;
     }
 
-    auto sp = it->second;
     unique_lock lock(sp->mtx[type]);
+    if (sp->replied[type] >= sp->requested[type]) // reply to a message not waiting for reply
+        return;
+    const auto seq = ++sp->replied[type];
     if (data) { // has return value or out parameters
         memcpy(&sp->data[type], data, sizeof(CallbackReply));
     }
-    sp->dataReady[type] = true;
-    sp->cv[type].notify_one();
+    if (sp->replyMode[type] != ReplyAsync) {
+        sp->cv[type].notify_one();
+        return;
+    }
+    auto& deadlines = sp->deadlines[type];
+    auto late = true;
+    while (!deadlines.empty() && deadlines.front().first <= seq) {
+        if (deadlines.front().first == seq)
+            late = chrono::steady_clock::now() > deadlines.front().second;
+        deadlines.pop_front();
+    }
+    if (late || !data)
+        return;
+    const auto d = sp->data[type];
+    lock.unlock();
+    // fallback value was returned to mdk, apply dart decision now
+    switch (type) {
+    case CallbackType::MediaStatus:
+        if (!d.mediaStatus.ret)
+            sp->set(mdk::State::Stopped);
+        break;
+    case CallbackType::Prepared:
+        if (!d.prepared.ret)
+            sp->set(mdk::State::Stopped);
+        break;
+    default:
+        break;
+    }
 }
 
-FVP_EXPORT bool MdkPrepare(int64_t handle, int64_t pos, int64_t seekFlags, void* post_c_object, int64_t send_port)
+FVP_EXPORT void MdkCallbacksSetReplyMode(int64_t handle, int type, int mode, int timeoutMs, const void* fallback)
 {
-    const auto it = players.find(handle);
-    if (it == players.cend()) {
+    auto sp = players.get(handle);
+    if (!sp || type < 0 || type >= CallbackType::Count) {
+        return;
+    }
+
+    scoped_lock lock(sp->mtx[type]);
+    sp->replyMode[type] = ReplyMode(mode);
+    sp->replyTimeout[type] = timeoutMs;
+    if (fallback) {
+        memcpy(&sp->fallback[type], fallback, sizeof(CallbackReply));
+    }
+}
+
+FVP_EXPORT void MdkCallbacksSetCoalescing(int64_t handle, const char* category, int intervalMs)
+{
+    auto sp = players.get(handle);
+    if (!sp || !category) {
+        return;
+    }
+
+    scoped_lock lock(sp->coalesceMtx);
+    if (intervalMs > 0) {
+        sp->coalesce[category].interval = chrono::milliseconds(intervalMs);
+    } else {
+        sp->coalesce.erase(category); // pending event is dropped
+    }
+    sp->coalescing = !sp->coalesce.empty();
+}
+
+FVP_EXPORT void MdkCallbacksSetLogForwarding(int level, int intervalMs, int capacity)
+{
+    LogForwarder::instance().configure(level, intervalMs, capacity);
+}
+
+FVP_EXPORT int64_t MdkCallbacksLogDropped()
+{
+    return LogForwarder::instance().dropped();
+}
+
+FVP_EXPORT bool MdkCallbacksSetTraceFile(const char* path, int64_t size)
+{
+    static mutex mtx;
+    static unique_ptr<fvp::TraceFile> current;
+    scoped_lock lock(mtx);
+    unique_ptr<fvp::TraceFile> t;
+    if (path && *path) {
+        t = fvp::TraceFile::create(path, size);
+        if (!t) {
+            clog << "failed to create trace file " << path << endl;
+            return false;
+        }
+    }
+    gTrace.store(t.get());
+    updateLogHandler();
+    const auto e = gTraceEpoch.fetch_add(1);
+    while (gTraceWriters[e & 1].load(memory_order_acquire) > 0) // writers of the previous epoch may still append to the old file
+        this_thread::yield();
+    current = std::move(t);
+    return true;
+}
+
+FVP_EXPORT void MdkSetRenderTargetPoolLimit(int64_t bytes)
+{
+    fvp::renderTargetPoolLimit() = std::max<int64_t>(bytes, 0);
+}
+
+FVP_EXPORT void MdkSetSpanTracing(bool enable)
+{
+    fvp::SpanRecorder::instance().setEnabled(enable);
+}
+
+FVP_EXPORT bool MdkDumpSpans(const char* path)
+{
+    if (!path)
         return false;
+    return fvp::SpanRecorder::instance().dump(path);
+}
+
+FVP_EXPORT void MdkCallbacksSetPacked(int64_t handle, int types)
+{
+    const auto supported = handle ? (1 << CallbackType::State) | (1 << CallbackType::MediaStatus) | (1 << CallbackType::Seek) : (1 << CallbackType::Log);
+    if (!handle) {
+        gPackedTypes = types & supported;
+        return;
     }
-    const auto postCObject = reinterpret_cast<bool(*)(Dart_Port, Dart_CObject*)>(post_c_object);
-    auto sp = it->second;
+
+    auto sp = players.get(handle);
+    if (!sp) {
+        return;
+    }
+
+    sp->packedTypes = types & supported;
+}
+
+FVP_EXPORT void* MdkCallbacksEnableEventBatch(int64_t handle, int capacity)
+{
+    auto sp = players.get(handle);
+    if (!sp || capacity <= 0) {
+        return nullptr;
+    }
+
+    if (const auto ring = sp->ring.load()) { // can not resize, mdk threads may be writing
+        return sp->ringSize == capacity ? ring : nullptr;
+    }
+    sp->ringData = make_unique<CallbackRecord[]>(capacity);
+    sp->ringSize = capacity;
+    sp->ring.store(sp->ringData.get(), memory_order_release);
+    return sp->ringData.get();
+}
+
+FVP_EXPORT int64_t MdkCallbacksRingCommit(int64_t handle, int64_t readIndex)
+{
+    auto sp = players.get(handle);
+    if (!sp) {
+        return readIndex;
+    }
+
+    sp->ringWakePending = false;
+    sp->ringRead.store(readIndex, memory_order_release);
+    return sp->ringWrite.load();
+}
+
+FVP_EXPORT bool MdkGetPlayerStats(int64_t handle, PlayerStats* out)
+{
+    const auto c = counters.get(handle);
+    if (!c || !out) {
+        return false;
+    }
+
+    *out = {
+        .eventsPosted = c->eventsPosted.load(memory_order_relaxed),
+        .postErrors = c->postErrors.load(memory_order_relaxed),
+        .eventsDropped = c->eventsDropped.load(memory_order_relaxed),
+        .replyWaits = c->replyWaits.load(memory_order_relaxed),
+        .replyWaitUs = c->replyWaitUs.load(memory_order_relaxed),
+        .renderCalls = c->renderCalls.load(memory_order_relaxed),
+        .renderUs = c->renderUs.load(memory_order_relaxed),
+        .framesPresented = c->framesPresented.load(memory_order_relaxed),
+        .renderSkipped = c->renderSkipped.load(memory_order_relaxed),
+        .seeksRequested = c->seeksRequested.load(memory_order_relaxed),
+        .seeksElided = c->seeksElided.load(memory_order_relaxed),
+    };
+    return true;
+}
+
+FVP_EXPORT bool MdkGetPlayerStartup(int64_t handle, PlayerStartup* out)
+{
+    const auto c = counters.get(handle);
+    if (!c || !out) {
+        return false;
+    }
+
+    const auto t0 = c->startup[fvp::Prepare].load(memory_order_acquire);
+    const auto since = [&](fvp::StartupMark m) -> int64_t {
+        const auto t = c->startup[m].load(memory_order_relaxed);
+        return t0 && t ? t - t0 : -1;
+    };
+    *out = {
+        .prepared = since(fvp::Prepared),
+        .videoDecoder = since(fvp::VideoDecoder),
+        .firstRender = since(fvp::FirstRender),
+        .firstPresent = since(fvp::FirstPresent),
+    };
+    return t0 != 0;
+}
+
+FVP_EXPORT int MdkGetStartupHistogram(int phase, int64_t* counts, int count)
+{
+    if (phase < 0 || phase >= fvp::PhaseCount || !counts) {
+        return 0;
+    }
+    const auto& h = fvp::startupHistogram();
+    count = std::min(count, fvp::StartupHistogram::kBuckets);
+    for (int i = 0; i < count; ++i)
+        counts[i] = h.counts[phase][i].load(memory_order_relaxed);
+    return count;
+}
+
+FVP_EXPORT void* MdkGetPlayerStatus(int64_t handle)
+{
+    auto sp = players.get(handle);
+    if (!sp) {
+        return nullptr;
+    }
+    return &sp->stats->status;
+}
+
+FVP_EXPORT void MdkReadPlayerStatus(const void* status, void* out)
+{
+    auto d = static_cast<fvp::PlayerStatus*>(out);
+    fvp::readStatus(*static_cast<const fvp::PlayerStatus*>(status), [d](const fvp::PlayerStatus& s) {
+        d->seq.store(s.seq.load(memory_order_relaxed), memory_order_relaxed);
+        d->position.store(s.position.load(memory_order_relaxed), memory_order_relaxed);
+        d->buffered.store(s.buffered.load(memory_order_relaxed), memory_order_relaxed);
+        d->duration.store(s.duration.load(memory_order_relaxed), memory_order_relaxed);
+        d->renderTime.store(s.renderTime.load(memory_order_relaxed), memory_order_relaxed);
+        d->fps.store(s.fps.load(memory_order_relaxed), memory_order_relaxed);
+        d->state.store(s.state.load(memory_order_relaxed), memory_order_relaxed);
+        d->mediaStatus.store(s.mediaStatus.load(memory_order_relaxed), memory_order_relaxed);
+        d->videoWidth.store(s.videoWidth.load(memory_order_relaxed), memory_order_relaxed);
+        d->videoHeight.store(s.videoHeight.load(memory_order_relaxed), memory_order_relaxed);
+        return 0;
+    });
+}
+
+FVP_EXPORT bool MdkSetSyncClock(int64_t handle, bool enable, int minIntervalMs)
+{
+    auto sp = players.get(handle);
+    if (!sp) {
+        return false;
+    }
+    if (!enable) {
+        sp->onSync(nullptr);
+        return true;
+    }
+    // called when about to render a frame, must not block
+    sp->onSync([clock = sp->syncClock]{
+        return clock->position();
+    }, minIntervalMs);
+    return true;
+}
+
+FVP_EXPORT void MdkUpdateSyncClock(int64_t handle, double position, double rate)
+{
+    auto sp = players.get(handle);
+    if (!sp) {
+        return;
+    }
+    sp->syncClock->update(position, rate);
+}
+
+FVP_EXPORT void* MdkGetSyncClock(int64_t handle)
+{
+    auto sp = players.get(handle);
+    if (!sp) {
+        return nullptr;
+    }
+    return sp->syncClock.get();
+}
+
+FVP_EXPORT bool MdkGetSyncClockStats(int64_t handle, SyncClockStats* out)
+{
+    auto sp = players.get(handle);
+    if (!sp || !out) {
+        return false;
+    }
+    const auto s = sp->syncClock->stats();
+    *out = {
+        .updates = s.updates,
+        .reads = s.reads,
+        .retries = s.retries,
+        .lastDriftUs = s.lastDriftUs,
+        .maxDriftUs = s.maxDriftUs,
+        .meanDriftUs = s.meanDriftUs,
+    };
+    return true;
+}
+
+// slow tasks, e.g. encoders and prepare, run on a few threads instead of mdk render/callback threads and dart thread
+class WorkerPool
+{
+public:
+    // encoders
+    static WorkerPool& instance() {
+        static auto p = new WorkerPool(std::clamp((int)thread::hardware_concurrency() / 2, 1, 4));
+        return *p;
+    }
+
+    // tasks waiting for players, e.g. prepare waits for the previous media to stop, so they never delay encoders
+    static WorkerPool& blocking() {
+        static auto p = new WorkerPool(8);
+        return *p;
+    }
+
+    // headless thumbnail players of all MdkThumbnails() calls. decoding is cpu bound
+    static WorkerPool& decoders() {
+        static auto p = new WorkerPool(kMaxDecoders);
+        return *p;
+    }
+    static constexpr int kMaxDecoders = 4;
+
+    void post(function<void()>&& f) {
+        scoped_lock lock(mtx_);
+        if (workers_ < maxWorkers_ && idle_ == 0) {
+            ++workers_;
+            thread([this]{ run(); }).detach();
+        }
+        tasks_.push_back(std::move(f));
+        cv_.notify_one();
+    }
+
+private:
+    WorkerPool(int maxWorkers) : maxWorkers_(maxWorkers) {}
+
+    void run() {
+        unique_lock lock(mtx_);
+        while (true) {
+            ++idle_;
+            cv_.wait(lock, [this]{ return !tasks_.empty(); });
+            --idle_;
+            auto f = std::move(tasks_.front());
+            tasks_.pop_front();
+            lock.unlock();
+            f();
+            lock.lock();
+        }
+    }
+
+    const int maxWorkers_;
+    int workers_ = 0;
+    int idle_ = 0;
+    mutex mtx_;
+    condition_variable cv_;
+    deque<function<void()>> tasks_;
+};
+
+// run queued control calls until empty. a blocking one and the rest are moved to a worker if not in a worker
+static void runCommands(const shared_ptr<Player>& sp, bool worker)
+{
+    unique_lock lock(sp->commandMtx);
+    while (!sp->commands.empty()) {
+        if (!worker && sp->commands.front().blocking) {
+            WorkerPool::blocking().post([wp = weak_ptr<Player>(sp)]{
+                if (auto sp = wp.lock())
+                    runCommands(sp, true);
+            });
+            return;
+        }
+        auto f = std::move(sp->commands.front().run);
+        sp->commands.pop_front();
+        lock.unlock();
+        f();
+        lock.lock();
+    }
+    sp->commandsRunning = false;
+    sp->commandsIdle.notify_all();
+}
+
+// control calls of a player are applied in call order. f runs in the caller thread if no previous call is pending, otherwise it's queued,
+// e.g. set(State::Playing) right after MdkPrepare() runs after the previous media is stopped and prepare() is called.
+// return false if the player is unregistered, f is dropped
+static bool runInOrder(const shared_ptr<Player>& sp, function<void()>&& f, bool blocking = false)
+{
+    {
+        scoped_lock lock(sp->commandMtx);
+        if (sp->closed)
+            return false;
+        sp->commands.push_back({ std::move(f), blocking });
+        if (sp->commandsRunning)
+            return true;
+        sp->commandsRunning = true;
+    }
+    runCommands(sp, false);
+    return true;
+}
+
+// run f in a blocking worker unless the player is unregistered. MdkCallbacksUnregisterPort() waits for it
+static void postTask(const shared_ptr<Player>& sp, function<void()>&& f)
+{
+    {
+        scoped_lock lock(sp->commandMtx);
+        if (sp->closed)
+            return;
+        ++sp->tasks;
+    }
+    WorkerPool::blocking().post([sp, f = std::move(f)]{
+        f();
+        scoped_lock lock(sp->commandMtx);
+        if (--sp->tasks == 0)
+            sp->commandsIdle.notify_all();
+    });
+}
+
+static constexpr int64_t kPrepareCancelled = -11; // position posted if a newer MdkPrepare() is called
+
+// post prepared result of generation gen, lock of the type is held if waiting for reply. nothing is posted if cancelled by MdkCancel()
+static bool postPrepared(Player* p, int64_t gen, int64_t position, bool live, Dart_PostCObject postCObject, Dart_Port send_port)
+{
+    if (p->cancelled(CallbackType::Prepared, gen))
+        return false;
+    Dart_CObject t{
+        .type = Dart_CObject_kInt64,
+        .value = {
+            .as_int64 = int(CallbackType::Prepared),
+        }
+    };
+    Dart_CObject v{
+        .type = Dart_CObject_kInt64,
+        .value = {
+            .as_int64 = position,
+        }
+    };
+    Dart_CObject l{
+        .type = Dart_CObject_kBool,
+        .value = {
+            .as_bool = live,
+        }
+    };
+    Dart_CObject g{
+        .type = Dart_CObject_kInt64,
+        .value = {
+            .as_int64 = gen,
+        }
+    };
+    Dart_CObject* arr[] = { &t, &v, &l, &g };
+    Dart_CObject msg {
+        .type = Dart_CObject_kArray,
+        .value = {
+            .as_array = {
+                .length = std::size(arr),
+                .values = arr,
+            },
+        },
+    };
+    if (!post(*p->stats, postCObject, send_port, &msg)) {
+        clog << __func__ << __LINE__ << " postCObject error" << endl; // when?
+        return false;
+    }
+    return true;
+}
+
+// media of the status is prepared
+static void updateStatus(fvp::PlayerCounters& c, const mdk::MediaInfo& info, int64_t position)
+{
+    const auto codec = info.video.empty() ? mdk::VideoCodecParameters{} : info.video[0].codec;
+    c.startTime.store(info.start_time, memory_order_relaxed);
+    fvp::StatusWriter s(c);
+    s->position.store(std::max<int64_t>(position, 0), memory_order_relaxed);
+    s->duration.store(info.duration, memory_order_relaxed);
+    s->renderTime.store(0, memory_order_relaxed);
+    s->fps.store(codec.frame_rate, memory_order_relaxed);
+    s->videoWidth.store(codec.width, memory_order_relaxed);
+    s->videoHeight.store(codec.height, memory_order_relaxed);
+}
+
+// stop the previous media and prepare in a worker. return false if cancelled by a newer MdkPrepare() or MdkCancel()
+static bool prepareInWorker(const shared_ptr<Player>& sp, int64_t gen, int64_t pos, int64_t seekFlags, Dart_PostCObject postCObject, Dart_Port send_port, thread::id tid, int64_t t0)
+{
+    auto p = sp.get();
+    if (p->abandoned(CallbackType::Prepared, gen))
+        return false;
+    {
+        fvp::ScopedSpan span("stop", p->handle);
+        p->set(mdk::State::Stopped);
+        while (!p->waitFor(mdk::State::Stopped, 20)) { // ensure correct state
+            if (p->abandoned(CallbackType::Prepared, gen))
+                return false;
+        }
+    }
+    if (p->abandoned(CallbackType::Prepared, gen))
+        return false;
+    const auto handle = p->handle;
     auto wp = weak_ptr<Player>(sp);
-    const auto tid = this_thread::get_id();
-    sp->set(mdk::State::Stopped);
-    sp->waitFor(mdk::State::Stopped); // ensure correct state
-    sp->prepare(pos, [send_port, postCObject, wp, tid](int64_t position, bool* boost){
+    p->prepare(pos, [send_port, postCObject, wp, tid, handle, t0, gen](int64_t position, bool* boost){
+        fvp::SpanRecorder::instance().record("prepare", handle, t0, fvp::SpanRecorder::now());
         auto sp = wp.lock();
         if (!sp)
             return false;
         auto p = sp.get();
+        p->preparedGen = gen; // MdkCancel() from now on is applied by returning false here
+        if (p->abandoned(CallbackType::Prepared, gen)) { // stop loading. a newer MdkPrepare() will stop this one
+            postPrepared(p, gen, kPrepareCancelled, false, postCObject, send_port);
+            return false;
+        }
+        fvp::markStartup(*p->stats, fvp::Prepared);
         const auto info = p->mediaInfo();
+        updateStatus(*p->stats, info, position);
         const auto type = int(CallbackType::Prepared);
         unique_lock lock(p->mtx[type]);
-        p->dataReady[type] = false;
-        Dart_CObject t{
-            .type = Dart_CObject_kInt64,
-            .value = {
-                .as_int64 = type,
-            }
-        };
-        Dart_CObject v{
-            .type = Dart_CObject_kInt64,
-            .value = {
-                .as_int64 = position,
-            }
-        };
 // live video duration is 0 when prepared, and then increases to max read time
-        Dart_CObject live{
-            .type = Dart_CObject_kBool,
-            .value = {
-                .as_bool = info.duration <= 0,
-            }
-        };
-        Dart_CObject* arr[] = { &t, &v, &live };
-        Dart_CObject msg {
-            .type = Dart_CObject_kArray,
-            .value = {
-                .as_array = {
-                    .length = std::size(arr),
-                    .values = arr,
-                },
-            },
-        };
-        if (!postCObject(send_port, &msg)) {
-            clog << __func__ << __LINE__ << " postCObject error" << endl; // when?
+        if (!postPrepared(p, gen, position, info.duration <= 0, postCObject, send_port))
             return false;
-        }
         if (!p->reply[type])
             return true;
         if (tid == this_thread::get_id()) {// FIXME: can not convert dart non-static function to native function, and dart object has no address, so func(context, args) is impossible too
             clog << __func__ << "callback in main thread. won't wait callback" << endl;
             return true;
         }
-        p->cv[type].wait(lock, [=]{
-            return p->dataReady[type] || !(p->callbackTypes & (1 << type));
-        });
-        *boost = p->data[type].prepared.boost;
-        return p->data[type].prepared.ret;
+        const auto& d = waitReply(p, type, lock) ? p->data[type] : p->fallback[type];
+        *boost = d.prepared.boost;
+        return d.prepared.ret;
     }, mdk::SeekFlag(seekFlags));
     return true;
 }
 
-FVP_EXPORT bool MdkSeek(int64_t handle, int64_t pos, int64_t seekFlags, void* post_c_object, int64_t send_port)
+FVP_EXPORT int64_t MdkPrepare(int64_t handle, int64_t pos, int64_t seekFlags, void* post_c_object, int64_t send_port)
 {
-    const auto it = players.find(handle);
-    if (it == players.cend()) {
-        return false;
+    auto sp = players.get(handle);
+    if (!sp) {
+        return 0;
     }
+
     const auto postCObject = reinterpret_cast<bool(*)(Dart_Port, Dart_CObject*)>(post_c_object);
-    auto sp = it->second;
-    return sp->seek(pos, mdk::SeekFlag(seekFlags), [=](int64_t position){
-        Dart_CObject t{
-            .type = Dart_CObject_kInt64,
-            .value = {
-                .as_int64 = CallbackType::Seek,
+    const auto tid = this_thread::get_id();
+    const auto gen = sp->beginOp(CallbackType::Prepared);
+    const auto t0 = fvp::SpanRecorder::now();
+    fvp::resetStartup(*sp->stats);
+    if (const auto r = sp->seeks.reset(); r && !sp->cancelled(CallbackType::Seek, r->seq)) // the in-flight one is finished by mdk
+        postValues(sp.get(), postCObject, send_port, CallbackType::Seek, { -3, r->seq }); // -3: unloaded, like mdk
+    // stopping the previous media can take long, never block the caller(dart ui thread). later control calls wait for it
+    runInOrder(sp, [wp = weak_ptr<Player>(sp), gen, pos, seekFlags, postCObject, send_port, tid, t0]{
+        auto sp = wp.lock();
+        if (!sp)
+            return;
+        if (!prepareInWorker(sp, gen, pos, seekFlags, postCObject, send_port, tid, t0))
+            postPrepared(sp.get(), gen, kPrepareCancelled, false, postCObject, send_port);
+    }, true);
+    return gen;
+}
+
+// issue r, then the pending requests arrived before it's finished. only the result of the last one is posted
+static void issueSeek(const shared_ptr<Player>& sp, fvp::SeekScheduler::Request r, Dart_PostCObject postCObject, Dart_Port send_port)
+{
+    auto p = sp.get();
+    const auto handle = p->handle;
+    auto wp = weak_ptr<Player>(sp);
+    while (true) {
+        const auto t0 = fvp::SpanRecorder::now();
+        if (p->seek(r.position, mdk::SeekFlag(r.flags), [=](int64_t position){
+            fvp::SpanRecorder::instance().record("seek", handle, t0, fvp::SpanRecorder::now());
+            auto sp = wp.lock();
+            if (!sp)
+                return false;
+            if (const auto next = sp->seeks.finished(r.seq)) { // dart is waiting for next only. not reentered in mdk callback
+                postTask(sp, [wp, next = *next, postCObject, send_port]{
+                    if (auto sp = wp.lock())
+                        issueSeek(sp, next, postCObject, send_port);
+                });
+                return true;
             }
-        };
-        Dart_CObject v{
-            .type = Dart_CObject_kInt64,
-            .value = {
-                .as_int64 = position,
+            if (position >= 0) {
+                fvp::StatusWriter s(*sp->stats);
+                s->position.store(position, memory_order_relaxed);
             }
-        };
-        Dart_CObject* arr[] = { &t, &v };
-        Dart_CObject msg {
-            .type = Dart_CObject_kArray,
-            .value = {
-                .as_array = {
-                    .length = std::size(arr),
-                    .values = arr,
-                },
-            },
-        };
-        if (!postCObject(send_port, &msg)) {
-            clog << __func__ << __LINE__ << " postCObject error" << endl; // when?
-            return false;
+            if (sp->cancelled(CallbackType::Seek, r.seq))
+                return true;
+            if (!postValues(sp.get(), postCObject, send_port, CallbackType::Seek, { position, r.seq })) {
+                clog << __func__ << __LINE__ << " postCObject error" << endl; // when?
+                return false;
+            }
+            return true;
+        })) {
+            return;
         }
-        return true;
+        const auto next = p->seeks.finished(r.seq);
+        if (!next) {
+            if (!p->cancelled(CallbackType::Seek, r.seq))
+                postValues(p, postCObject, send_port, CallbackType::Seek, { -1, r.seq });
+            return;
+        }
+        r = *next;
+    }
+}
+
+FVP_EXPORT int64_t MdkSeek(int64_t handle, int64_t pos, int64_t seekFlags, void* post_c_object, int64_t send_port)
+{
+    auto sp = players.get(handle);
+    if (!sp) {
+        return 0;
+    }
+
+    const auto postCObject = reinterpret_cast<bool(*)(Dart_Port, Dart_CObject*)>(post_c_object);
+    const fvp::SeekScheduler::Request r{ pos, int(seekFlags), sp->beginOp(CallbackType::Seek) };
+    sp->stats->seeksRequested.fetch_add(1, memory_order_relaxed);
+    if (sp->seeks.request(r)) {
+        runInOrder(sp, [wp = weak_ptr<Player>(sp), r, postCObject, send_port]{
+            if (auto sp = wp.lock())
+                issueSeek(sp, r, postCObject, send_port);
+        });
+    }
+    return r.seq;
+}
+
+FVP_EXPORT bool MdkSetState(int64_t handle, int state)
+{
+    auto sp = players.get(handle);
+    if (!sp) {
+        return false;
+    }
+    return runInOrder(sp, [wp = weak_ptr<Player>(sp), state]{
+        if (auto sp = wp.lock())
+            sp->set(mdk::State(state));
+    });
+}
+
+FVP_EXPORT bool MdkSetMedia(int64_t handle, const char* url, int type)
+{
+    auto sp = players.get(handle);
+    if (!sp) {
+        return false;
+    }
+    return runInOrder(sp, [wp = weak_ptr<Player>(sp), url = string(url ? url : ""), type]{
+        auto sp = wp.lock();
+        if (!sp)
+            return;
+        if (type < 0)
+            sp->setMedia(url.data());
+        else
+            sp->setMedia(url.data(), mdk::MediaType(type));
     });
 }
 
 extern "C" void* MdkGetPlayerVid(int64_t texId);
 
-FVP_EXPORT bool MdkSnapshot(int64_t handle, int64_t texId, int w, int h, void* post_c_object, int64_t send_port)
+// Reusable buffers for external typed data posted to dart, e.g. periodic snapshots of the same size.
+// Buffers are returned by dart finalizer in any thread. intentionally leaked because finalizers can run on exit
+class BufferPool
+{
+public:
+    static BufferPool& instance() {
+        static auto p = new BufferPool();
+        return *p;
+    }
+
+    uint8_t* acquire(size_t size) {
+        scoped_lock lock(mtx_);
+        auto it = free_.lower_bound(size);
+        if (it != free_.end() && it->first <= size * 2) { // avoid wasting a much larger buffer
+            const auto capacity = it->first;
+            auto data = it->second.release();
+            free_.erase(it);
+            freeBytes_ -= capacity;
+            used_[data] = capacity;
+            return data;
+        }
+        auto data = new uint8_t[size];
+        used_[data] = size;
+        return data;
+    }
+
+    void release(uint8_t* data) {
+        scoped_lock lock(mtx_);
+        const auto it = used_.find(data);
+        if (it == used_.end())
+            return;
+        const auto capacity = it->second;
+        used_.erase(it);
+        while (!free_.empty() && freeBytes_ + capacity > kMaxFreeBytes) { // drop the largest, usually from an old resolution
+            const auto last = prev(free_.end());
+            freeBytes_ -= last->first;
+            free_.erase(last);
+        }
+        if (capacity > kMaxFreeBytes) {
+            delete[] data;
+            return;
+        }
+        free_.emplace(capacity, unique_ptr<uint8_t[]>(data));
+        freeBytes_ += capacity;
+    }
+
+private:
+    static constexpr size_t kMaxFreeBytes = 128 << 20; // about 4 4K rgba frames
+
+    mutex mtx_;
+    unordered_map<uint8_t*, size_t> used_; // data => capacity
+    multimap<size_t, unique_ptr<uint8_t[]>> free_; // capacity => data
+    size_t freeBytes_ = 0;
+};
+
+// a buffer from BufferPool, returned to pool in destructor unless detached
+struct PooledBuffer {
+    explicit PooledBuffer(size_t size) : data(BufferPool::instance().acquire(size)) {}
+    ~PooledBuffer() {
+        if (data)
+            BufferPool::instance().release(data);
+    }
+    uint8_t* detach() { return std::exchange(data, nullptr); }
+
+    uint8_t* data;
+};
+
+static bool postSnapshot(fvp::PlayerCounters& stats, int64_t op, shared_ptr<PooledBuffer> buf, size_t size, Dart_PostCObject postCObject, Dart_Port send_port)
+{
+    Dart_CObject t{
+        .type = Dart_CObject_kInt64,
+        .value = {
+            .as_int64 = CallbackType::Snapshot,
+        }
+    };
+    Dart_CObject v{
+        .type = Dart_CObject_kExternalTypedData, // no copy, buffer is returned to pool by dart finalizer
+        .value = {
+            .as_external_typed_data = {
+                .type = Dart_TypedData_kUint8,
+                .length = (intptr_t)size,
+                .data = buf->data,
+                .peer = buf->data,
+                .callback = [](void*, void* peer) {
+                    BufferPool::instance().release(static_cast<uint8_t*>(peer));
+                },
+            },
+        }
+    };
+    Dart_CObject o{
+        .type = Dart_CObject_kInt64,
+        .value = {
+            .as_int64 = op,
+        }
+    };
+    Dart_CObject* arr[] = { &t, &v, &o };
+    Dart_CObject msg {
+        .type = Dart_CObject_kArray,
+        .value = {
+            .as_array = {
+                .length = std::size(arr),
+                .values = arr,
+            },
+        },
+    };
+    if (!post(stats, postCObject, send_port, &msg)) {
+        clog << __func__ << __LINE__ << " postCObject error" << endl; // when?
+        return false;
+    }
+    buf->detach(); // owned by dart now
+    return true;
+}
+
+// encode packed rgba via a temporary file, mdk has no in memory image encoding api. empty result if failed
+// mdk encoders write files only. no default temp dir, e.g. TMPDIR is not set on android
+static mutex cacheDirMtx;
+static string cacheDir;
+
+FVP_EXPORT void MdkSetCacheDir(const char* dir)
+{
+    scoped_lock lock(cacheDirMtx);
+    cacheDir = dir ? dir : "";
+}
+
+// encode into a file in cache dir and read back. return null and set error if failed
+static shared_ptr<PooledBuffer> encodeSnapshot(const uint8_t* rgba, int w, int h, const string& format, int quality, size_t* size, string& error)
+{
+    fvp::ScopedSpan span("encode snapshot");
+    static atomic<int> id = 0;
+    string file;
+    {
+        scoped_lock lock(cacheDirMtx);
+        file = cacheDir;
+    }
+    if (file.empty()) {
+        error = "no cache dir";
+        return {};
+    }
+    file += "/fvp-snapshot-" + to_string(++id) + "." + format;
+    int strides[] = { w * 4 };
+    const uint8_t* data[] = { rgba };
+    if (!mdk::VideoFrame(w, h, mdk::PixelFormat::RGBA, strides, data).save(file.data(), format.data(), quality < 0 ? -1.0f : quality / 100.0f)) {
+        error = "failed to encode " + format;
+        std::remove(file.data());
+        return {};
+    }
+    shared_ptr<PooledBuffer> out;
+    if (ifstream f(file, ios::binary | ios::ate); f) { // closed before removed
+        *size = (size_t)f.tellg();
+        f.seekg(0);
+        out = make_shared<PooledBuffer>(*size);
+        if (!f.read(reinterpret_cast<char*>(out->data), *size))
+            out.reset();
+    }
+    std::remove(file.data());
+    if (!out)
+        error = "failed to read " + file;
+    return out;
+}
+
+// dart completes the snapshot future with the error
+static bool postSnapshotError(fvp::PlayerCounters& stats, int64_t op, const string& error, Dart_PostCObject postCObject, Dart_Port send_port)
 {
-    const auto it = players.find(handle);
-    if (it == players.cend()) {
+    Dart_CObject t{
+        .type = Dart_CObject_kInt64,
+        .value = {
+            .as_int64 = CallbackType::Snapshot,
+        }
+    };
+    Dart_CObject v{
+        .type = Dart_CObject_kString,
+        .value = {
+            .as_string = error.data(),
+        }
+    };
+    Dart_CObject o{
+        .type = Dart_CObject_kInt64,
+        .value = {
+            .as_int64 = op,
+        }
+    };
+    Dart_CObject* arr[] = { &t, &v, &o };
+    Dart_CObject msg {
+        .type = Dart_CObject_kArray,
+        .value = {
+            .as_array = {
+                .length = std::size(arr),
+                .values = arr,
+            },
+        },
+    };
+    if (!post(stats, postCObject, send_port, &msg)) {
+        clog << __func__ << __LINE__ << " postCObject error" << endl; // when?
         return false;
     }
+    return true;
+}
+
+FVP_EXPORT int64_t MdkSnapshot(int64_t handle, int64_t texId, int w, int h, int flags, const char* format, int quality, void* post_c_object, int64_t send_port)
+{
+    (void)texId; // android only
+    auto sp = players.get(handle);
+    if (!sp) {
+        return 0;
+    }
+
     const auto postCObject = reinterpret_cast<bool(*)(Dart_Port, Dart_CObject*)>(post_c_object);
-    auto sp = it->second;
+    const string fmt = format ? format : "";
+    if (!fmt.empty()) // encoders need packed rgba
+        flags &= ~SnapshotKeepStride;
     Player::SnapshotRequest req{
         .width = w,
         .height = h,
     };
-    sp->snapshot(&req, [=](const Player::SnapshotRequest* ret, double frameTime)->string {
-        Dart_CObject t{
-            .type = Dart_CObject_kInt64,
-            .value = {
-                .as_int64 = CallbackType::Snapshot,
-            }
-        };
-        Dart_CObject v{
-            .type = Dart_CObject_kTypedData, // copy to dart. External: no copy
-            .value = {
-                .as_typed_data = {
-                    .type = Dart_TypedData_kUint8,
-                    .length = ret->stride * ret->height,
-                    .values = ret->data,
-                },
+    // size is known, mdk reads back into the pooled buffer directly, no copy
+    shared_ptr<PooledBuffer> buf;
+    if (w > 0 && h > 0) {
+        buf = make_shared<PooledBuffer>(size_t(w) * h * 4);
+        req.data = buf->data;
+        req.stride = w * 4;
+    }
+    const auto op = sp->beginOp(CallbackType::Snapshot);
+    // dart waits for the latest snapshot only
+    auto abandoned = [wp = weak_ptr<Player>(sp), op]{
+        auto sp = wp.lock();
+        return !sp || sp->abandoned(CallbackType::Snapshot, op);
+    };
+    sp->snapshot(&req, [=, stats = sp->stats](const Player::SnapshotRequest* ret, double) mutable ->string {
+        if (abandoned()) // mdk can not abort reading back, but no copy and encoding
+            return {};
+        const auto rowBytes = (flags & SnapshotKeepStride) ? ret->stride : ret->width * 4;
+        const auto size = size_t(rowBytes) * ret->height;
+        if (!buf || ret->data != buf->data || ret->stride != rowBytes) { // mdk allocated data is valid only in callback
+            buf = make_shared<PooledBuffer>(size);
+            if (ret->stride == rowBytes) {
+                memcpy(buf->data, ret->data, size);
+            } else {
+                for (int i = 0; i < ret->height; ++i)
+                    memcpy(buf->data + i * rowBytes, ret->data + i * ret->stride, rowBytes);
             }
-        };
-        Dart_CObject* arr[] = { &t, &v };
-        Dart_CObject msg {
-            .type = Dart_CObject_kArray,
-            .value = {
-                .as_array = {
-                    .length = std::size(arr),
-                    .values = arr,
-                },
-            },
-        };
-        if (!postCObject(send_port, &msg)) {
-            clog << __func__ << __LINE__ << " postCObject error" << endl; // when?
+        }
+        if (fmt.empty()) {
+            postSnapshot(*stats, op, buf, size, postCObject, send_port);
             return {};
         }
+        WorkerPool::instance().post([=, width = ret->width, height = ret->height]{
+            if (abandoned()) // queued encoding
+                return;
+            size_t encodedSize = 0;
+            string error;
+            const auto encoded = encodeSnapshot(buf->data, width, height, fmt, quality, &encodedSize, error);
+            if (abandoned())
+                return;
+            if (encoded) {
+                postSnapshot(*stats, op, encoded, encodedSize, postCObject, send_port);
+            } else { // dart still waits for a result
+                clog << __func__ << __LINE__ << " snapshot error: " << error << endl;
+                postSnapshotError(*stats, op, error, postCObject, send_port);
+            }
+        });
         return {};
     }
 #ifdef __ANDROID__
         , MdkGetPlayerVid(texId)
 #endif
     );
+    return op;
+}
+
+FVP_EXPORT bool MdkCancel(int64_t handle, int64_t op)
+{
+    auto sp = players.get(handle);
+    if (!sp) {
+        return false;
+    }
+    // only the latest op of a type can be waited by dart, older ones are cancelled too
+    for (auto type : { CallbackType::Prepared, CallbackType::Seek, CallbackType::Snapshot }) {
+        if (op <= 0 || sp->latestOp(type) != op)
+            continue;
+        auto& cancelled = sp->cancelledOps[int(type)];
+        for (auto v = cancelled.load(); v < op && !cancelled.compare_exchange_weak(v, op);) {}
+        if (type == CallbackType::Seek) {
+            sp->seeks.cancel(op);
+        } else if (type == CallbackType::Prepared && sp->preparedGen != op) {
+            // still stopping or loading(io, demuxer probing). stop now, before later control calls. otherwise mdk is stopped by the prepared callback
+            runInOrder(sp, [wp = weak_ptr<Player>(sp), op]{
+                auto sp = wp.lock();
+                if (!sp || sp->latestOp(CallbackType::Prepared) != op || sp->preparedGen == op)
+                    return;
+                fvp::ScopedSpan span("cancel prepare", sp->handle);
+                sp->set(mdk::State::Stopped);
+            }, true);
+        }
+        return true;
+    }
+    return false;
+}
+
+// frame of a thumbnail request taken by the frame callback of a headless player
+struct ThumbnailFrame {
+    mutex mtx;
+    condition_variable cv;
+    uint64_t gen = 0;  // the latest request
+    uint64_t want = 0; // request waiting for a frame, 0 if none
+    uint64_t frameGen = 0; // request of frame
+    mdk::VideoFrame frame;
+};
+
+// decode the nearest key frame of pos with a headless player and scale to w x h rgba. return frame timestamp in ms, or -1 if failed.
+// a timed out request is abandoned and the player is stopped, so a late frame of it never matches the next request, which prepares again
+static int64_t decodeThumbnail(mdk::Player& player, bool& prepared, int64_t pos, int w, int h, uint8_t* out, ThumbnailFrame& f)
+{
+    fvp::ScopedSpan span("decode thumbnail");
+    uint64_t gen = 0;
+    {
+        scoped_lock lock(f.mtx);
+        gen = ++f.gen;
+        f.want = gen;
+        f.frame = {};
+    }
+    const auto flags = mdk::SeekFlag::FromStart | mdk::SeekFlag::KeyFrame;
+    if (!prepared) {
+        player.prepare(pos, nullptr, flags);
+        player.set(mdk::State::Paused); // the frame of prepare and every seek is decoded, but never played
+        prepared = true;
+    } else {
+        player.seek(pos, flags);
+    }
+    unique_lock lock(f.mtx);
+    if (!f.cv.wait_for(lock, chrono::seconds(5), [&]{ return f.frameGen == gen; })) {
+        f.want = 0;
+        lock.unlock();
+        player.set(mdk::State::Stopped);
+        player.waitFor(mdk::State::Stopped, 1000);
+        prepared = false;
+        return -1;
+    }
+    auto rgba = f.frame.to(mdk::PixelFormat::RGBA, w, h);
+    lock.unlock();
+    if (!rgba)
+        return -1;
+    const auto data = rgba.bufferData(0);
+    const auto stride = rgba.bytesPerLine(0);
+    for (int i = 0; i < h; ++i)
+        memcpy(out + i * w * 4, data + i * stride, w * 4);
+    return int64_t(rgba.timestamp() * 1000.0);
+}
+
+// a MdkThumbnails() call. decoded by worker tasks, the last finished one posts the strip
+struct ThumbnailJob {
+    string url;
+    vector<int64_t> positions;
+    int w;
+    int h;
+    int workers;
+    size_t frameBytes;
+    shared_ptr<PooledBuffer> strip;
+    vector<int64_t> times;
+    atomic<int> running;
+    Dart_PostCObject postCObject;
+    Dart_Port send_port;
+};
+
+// decode every job->workers frames from t
+static void decodeThumbnails(ThumbnailJob* job, int t)
+{
+    mdk::Player player; // headless, frames are taken before rendering
+    player.setActiveTracks(mdk::MediaType::Audio, {});
+    player.setActiveTracks(mdk::MediaType::Subtitle, {});
+    player.setDecoders(mdk::MediaType::Video, {"FFmpeg"}); // host memory for conversion
+    player.setMedia(job->url.data());
+    ThumbnailFrame f;
+    player.onFrame<mdk::VideoFrame>([&f](mdk::VideoFrame& v, int) {
+        scoped_lock lock(f.mtx);
+        if (f.want && v) {
+            f.frame = v;
+            f.frameGen = std::exchange(f.want, 0);
+            f.cv.notify_one();
+        }
+        return 0;
+    });
+    bool prepared = false;
+    const auto count = (int)job->positions.size();
+    for (int i = t; i < count; i += job->workers)
+        job->times[i] = decodeThumbnail(player, prepared, job->positions[i], job->w, job->h, job->strip->data + i * job->frameBytes, f);
+    player.onFrame<mdk::VideoFrame>(nullptr);
+    player.set(mdk::State::Stopped);
+    player.waitFor(mdk::State::Stopped);
+}
+
+// [Thumbnails, timestamps, strip], or [Thumbnails, error] if the strip can not be posted, so dart future always completes
+static void postThumbnails(ThumbnailJob* job)
+{
+    const auto count = (intptr_t)job->positions.size();
+    Dart_CObject t{
+        .type = Dart_CObject_kInt64,
+        .value = {
+            .as_int64 = CallbackType::Thumbnails,
+        }
+    };
+    Dart_CObject ts{
+        .type = Dart_CObject_kTypedData,
+        .value = {
+            .as_typed_data = {
+                .type = Dart_TypedData_kInt64,
+                .length = count,
+                .values = reinterpret_cast<const uint8_t*>(job->times.data()),
+            },
+        }
+    };
+    Dart_CObject v{
+        .type = Dart_CObject_kExternalTypedData,
+        .value = {
+            .as_external_typed_data = {
+                .type = Dart_TypedData_kUint8,
+                .length = (intptr_t)(job->frameBytes * count),
+                .data = job->strip->data,
+                .peer = job->strip->data,
+                .callback = [](void*, void* peer) {
+                    BufferPool::instance().release(static_cast<uint8_t*>(peer));
+                },
+            },
+        }
+    };
+    Dart_CObject* arr[] = { &t, &ts, &v };
+    Dart_CObject msg {
+        .type = Dart_CObject_kArray,
+        .value = {
+            .as_array = {
+                .length = std::size(arr),
+                .values = arr,
+            },
+        },
+    };
+    if (job->postCObject(job->send_port, &msg)) {
+        job->strip->detach();
+        return;
+    }
+    clog << __func__ << __LINE__ << " postCObject error" << endl;
+    Dart_CObject e{
+        .type = Dart_CObject_kString,
+        .value = {
+            .as_string = "failed to post thumbnails",
+        }
+    };
+    Dart_CObject* err[] = { &t, &e };
+    msg.value.as_array = {
+        .length = std::size(err),
+        .values = err,
+    };
+    if (!job->postCObject(job->send_port, &msg)) // port is closed
+        clog << __func__ << __LINE__ << " postCObject error" << endl;
+}
+
+FVP_EXPORT bool MdkThumbnails(const char* url, const int64_t* positions, int count, int w, int h, int workers, void* post_c_object, int64_t send_port)
+{
+    if (!url || !positions || count <= 0 || w <= 0 || h <= 0) {
+        return false;
+    }
+    auto job = make_shared<ThumbnailJob>();
+    job->url = url;
+    job->positions.assign(positions, positions + count);
+    job->w = w;
+    job->h = h;
+    // decoders of all calls are limited by the pool, more workers of a call only wait in queue
+    job->workers = std::clamp(workers, 1, std::min(count, WorkerPool::kMaxDecoders));
+    job->frameBytes = size_t(w) * h * 4;
+    job->strip = make_shared<PooledBuffer>(job->frameBytes * count);
+    memset(job->strip->data, 0, job->frameBytes * count);
+    job->times.assign(count, -1);
+    job->running = job->workers;
+    job->postCObject = reinterpret_cast<bool(*)(Dart_Port, Dart_CObject*)>(post_c_object);
+    job->send_port = send_port;
+    for (int t = 0; t < job->workers; ++t) {
+        WorkerPool::decoders().post([job, t]{
+            decodeThumbnails(job.get(), t);
+            if (--job->running == 0)
+                postThumbnails(job.get());
+        });
+    }
     return true;
 }
@@ -18,29 +18,119 @@
 #define FVP_EXPORT FVP_EXTERN_C __attribute__((visibility("default"))) // will be built with objc compiler, c++ attribute can not be used
 #endif
 
+struct PlayerStats;
+struct PlayerStartup;
+struct SyncClockStats;
+
 FVP_EXPORT void MdkSetKey(const char* key);
 FVP_EXPORT void MdkCallbacksRegisterPort(int64_t handle, void* post_c_object, int64_t send_port);
+// pending operations are cancelled, and return after queued control calls and worker tasks of the player are finished. mdk player can be deleted then
 FVP_EXPORT void MdkCallbacksUnregisterPort(int64_t handle);
 FVP_EXPORT void MdkCallbacksRegisterType(int64_t handle, int type, bool reply);
 FVP_EXPORT void MdkCallbacksUnregisterType(int64_t handle, int type);
 FVP_EXPORT void MdkCallbacksReplyType(int64_t handle, int type, const void* data);
-FVP_EXPORT bool MdkPrepare(int64_t handle, int64_t pos, int64_t seekFlag, void* post_c_object, int64_t send_port);// prepare() with a callback to post result to dart to set Completer<int>
-FVP_EXPORT bool MdkSeek(int64_t handle, int64_t pos, int64_t seekFlag, void* post_c_object, int64_t send_port);
-FVP_EXPORT bool MdkSnapshot(int64_t handle, int64_t texId, int w, int h, void* post_c_object, int64_t send_port);
+// mode: ReplyMode. timeoutMs < 0: no timeout. fallback: CallbackReply used if no reply in time, null to keep current value
+FVP_EXPORT void MdkCallbacksSetReplyMode(int64_t handle, int type, int mode, int timeoutMs, const void* fallback);
+// copy counters of a player since port registered, return false if not found
+FVP_EXPORT bool MdkGetPlayerStats(int64_t handle, struct PlayerStats* out);
+// time to first frame breakdown of the latest MdkPrepare(), return false if not prepared by MdkPrepare()
+FVP_EXPORT bool MdkGetPlayerStartup(int64_t handle, struct PlayerStartup* out);
+// copy up to count buckets of a phase histogram of all players. phase: fvp::StartupPhase in stats.h, i.e. open, decoder init, render, present, total.
+// bucket 0 counts durations < 1ms, bucket i in [2^(i-1), 2^i) ms, the last one is unbounded. return buckets copied
+FVP_EXPORT int MdkGetStartupHistogram(int phase, int64_t* counts, int count);
+// prepare() with a callback to post result to dart to set Completer<int>. stopping current media and prepare() are in a worker thread, the caller is never blocked.
+// return generation(> 0) posted with the result, 0 if player not found. an older prepare is cancelled and its result position is -11.
+// the generation is an operation id for MdkCancel()
+FVP_EXPORT int64_t MdkPrepare(int64_t handle, int64_t pos, int64_t seekFlag, void* post_c_object, int64_t send_port);
+// at most 1 seek of a player is in flight. a seek requested before that finishes is pending, and replaces the previous pending one whose result
+// is never posted. relative seeks are merged into the pending one. return seq(> 0) posted with the result position, 0 if failed.
+// the seq is an operation id for MdkCancel()
+FVP_EXPORT int64_t MdkSeek(int64_t handle, int64_t pos, int64_t seekFlag, void* post_c_object, int64_t send_port);
+// MdkPrepare(), MdkSeek(), MdkSetState(), MdkSetMedia() and stopping by MdkCancel() are applied to mdk in call order. a call is applied in the
+// caller thread if no previous one is pending, otherwise after the pending ones in a worker, e.g. MdkSetState(Playing) right after MdkPrepare()
+// is applied after the previous media is stopped and prepare() is called. return false if player not found or unregistered
+FVP_EXPORT bool MdkSetState(int64_t handle, int state);
+// type: mdk MediaType, < 0 for the main media
+FVP_EXPORT bool MdkSetMedia(int64_t handle, const char* url, int type);
+// flags: SnapshotFlag. result is posted as external typed data backed by a buffer pool, followed by the returned operation id(> 0). 0 if player not found
+// format: null or empty for raw rgba, otherwise an image format supported by mdk VideoFrame.save(), e.g. "jpg", "png", "webp", encoded on a worker thread. quality: [0, 100], -1 for default
+// only the latest snapshot is posted, copying and encoding of older ones are skipped. if encoding failed, an error string is posted instead of data
+FVP_EXPORT int64_t MdkSnapshot(int64_t handle, int64_t texId, int w, int h, int flags, const char* format, int quality, void* post_c_object, int64_t send_port);
+// writable dir for temporary files of image encoders, e.g. app cache dir. encoding snapshots fails if not set
+FVP_EXPORT void MdkSetCacheDir(const char* dir);
+// cancel an operation returned by MdkPrepare(), MdkSeek() or MdkSnapshot() if it's the latest one of its kind. return false if not found.
+// no result is posted for the operation and older ones of the same kind. loading media is stopped, a pending seek is dropped,
+// and copying and encoding a snapshot are skipped. a seek in flight and reading back a snapshot can not be aborted in mdk
+FVP_EXPORT bool MdkCancel(int64_t handle, int64_t op);
+// deliver the latest event of category at most once per intervalMs. intervalMs <= 0: no coalescing
+FVP_EXPORT void MdkCallbacksSetCoalescing(int64_t handle, const char* category, int intervalMs);
+// stream mdk logs and events, state and media status of players into a memory mapped ring file of size bytes with timestamps and thread ids,
+// decoded by cmake/tools/trace_dump. independent of dart callbacks, mdk log handler is replaced while tracing. path null or empty: stop tracing
+// and restore the log handler. the previous file is unmapped after writers using it return
+FVP_EXPORT bool MdkCallbacksSetTraceFile(const char* path, int64_t size);
+// max bytes of render targets cached by each gl context for other players after textures are released, default 128MB. 0: no cache.
+// used by linux and elinux plugins, applied when a render target is released
+FVP_EXPORT void MdkSetRenderTargetPoolLimit(int64_t bytes);
+// slave playback to an external master clock, e.g. multi-screen sync. mdk sync callback reads the clock every minIntervalMs w/o messages.
+// the clock is paused at 0 until updated. enable false: playback clock is restored
+FVP_EXPORT bool MdkSetSyncClock(int64_t handle, bool enable, int minIntervalMs);
+// set master clock position in seconds at now, rate 0 if paused. lock free, can be called as a leaf ffi function for every frame
+FVP_EXPORT void MdkUpdateSyncClock(int64_t handle, double position, double rate);
+// fvp::SyncClock*(sync_clock.h) of a player for native code to update the clock directly, valid until the port is unregistered. null if not found
+FVP_EXPORT void* MdkGetSyncClock(int64_t handle);
+FVP_EXPORT bool MdkGetSyncClockStats(int64_t handle, struct SyncClockStats* out);
+// fvp::PlayerStatus*(stats.h) of a player, a seqlock updated by mdk callbacks on all platforms and render time by linux, elinux and windows
+// texture plugins. valid until the port is unregistered. null if not found
+FVP_EXPORT void* MdkGetPlayerStatus(int64_t handle);
+// copy fields of status returned by MdkGetPlayerStatus() from the same update into out of the same layout. a leaf call for dart in every frame
+FVP_EXPORT void MdkReadPlayerStatus(const void* status, void* out);
+// record timing spans of player lifecycle and rendering, e.g. prepare, seek, reply waits, postCObject, populate, renderVideo, render target creation
+FVP_EXPORT void MdkSetSpanTracing(bool enable);
+// write the latest recorded spans of each thread as chrome trace json, viewed in chrome://tracing or ui.perfetto.dev. return false if failed
+FVP_EXPORT bool MdkDumpSpans(const char* path);
+// types: bit mask of CallbackType posted as 1 packed Uint8List message(see PackedHeader) instead of an array. supported types: State, MediaStatus and Seek for a player, Log for handle 0
+FVP_EXPORT void MdkCallbacksSetPacked(int64_t handle, int types);
+// forward mdk logs whose level <= level(mdk::LogLevel) to dart, others are discarded in the logging thread.
+// intervalMs > 0: lines are queued(capacity is used the first time) and posted in batches by a native thread, lines are dropped if the queue is full
+FVP_EXPORT void MdkCallbacksSetLogForwarding(int level, int intervalMs, int capacity);
+// log lines dropped because the queue is full
+FVP_EXPORT int64_t MdkCallbacksLogDropped();
+// decode key frames nearest to positions(ms) of url in parallel with headless players, and post 1 message of frame timestamps(-1 if failed) and a w x (h*count) rgba strip,
+// or an error string if the strip can not be posted. workers are at most 4 players, shared by all calls
+FVP_EXPORT bool MdkThumbnails(const char* url, const int64_t* positions, int count, int w, int h, int workers, void* post_c_object, int64_t send_port);
+// opt-in event batching. return a ring of capacity CallbackRecord, or null if failed. events of registered non-reply types are written into the ring and dart is waked up by a CallbackType::Ring message
+// writers are serialized by a short per-player lock, dart reads records without locking
+// records are in the order of callbacks. other results, e.g. prepared, seek and reply types, are still port messages. dart drains the ring before handling
+// a port message, so a record written before a message is posted is handled before the message, but a record written later may be handled earlier
+FVP_EXPORT void* MdkCallbacksEnableEventBatch(int64_t handle, int capacity);
+// set ring read index to readIndex, return current write index. records in [readIndex, write index) are ready
+FVP_EXPORT int64_t MdkCallbacksRingCommit(int64_t handle, int64_t readIndex);
 
 enum CallbackType {
     Event, // not a callback, no need to wait for reply
     State,
     MediaStatus,
     Prepared,
-    Sync,
+    Sync,       // not posted. mdk reads the external clock set by MdkUpdateSyncClock() directly
     Log,
     Seek,       // no register, one time callback
     Snapshot,   // no register, one time callback
     SubtitleText,
+    Ring,       // no register, wake up dart to drain ring records
+    Thumbnails, // no register, one time callback
     Count,
 };
 
+enum SnapshotFlag {
+    SnapshotKeepStride = 1, // rows are not repacked to width*4 bytes
+};
+
+// How callbacks registered with reply wait for dart
+enum ReplyMode {
+    ReplyWait,  // block mdk thread until dart replies or timeout, then use the fallback value
+    ReplyAsync, // return the fallback value immediately. dart decision is applied when reply arrives before timeout, e.g. stop the player if prepared callback returns false
+};
+
 // Callback data from dart if callback has return type or out parameters
 union CallbackReply {
     struct {
@@ -54,3 +144,58 @@ union CallbackReply {
         bool boost;
     } prepared;
 };
+
+// Fixed size record in event ring. native endian, layout is shared with dart
+// Event: values[0] = error, text = category '\0' detail
+// State, MediaStatus: values[0] = old value, values[1] = new value
+// SubtitleText: values[0], values[1] = start, end as double, text = lines separated by '\0'
+// text is truncated if too long
+struct CallbackRecord {
+    int32_t type;
+    int32_t size; // text bytes
+    int64_t values[3];
+    char text[224];
+};
+
+// Header of a packed message, little endian, followed by payload
+// State, MediaStatus: int64 old value, int64 new value
+// Seek: int64 position, int64 seq returned by MdkSeek()
+// Log: lines of int32 level, int32 size, utf8 text w/o '\0'
+struct PackedHeader {
+    int32_t type;
+    uint32_t seq;  // increased by 1 for each packed message of a player, or of global callbacks
+    int64_t time;  // posted time, microseconds since epoch
+};
+
+// Accumulated counters of a player, layout is shared with dart
+struct PlayerStats {
+    int64_t eventsPosted;    // messages and ring records delivered to dart
+    int64_t postErrors;      // postCObject failures
+    int64_t eventsDropped;   // ring is full
+    int64_t replyWaits;      // callbacks blocked to wait for dart reply
+    int64_t replyWaitUs;     // time blocked in replyWaits
+    int64_t renderCalls;     // renderVideo() calls by texture plugins
+    int64_t renderUs;        // time spent in renderVideo()
+    int64_t framesPresented; // new frames given to flutter
+    int64_t renderSkipped;   // repaints w/o a new frame, texture is reused
+    int64_t seeksRequested;  // MdkSeek() calls
+    int64_t seeksElided;     // seeks never issued because a newer one replaced them before the in-flight seek finished
+};
+
+// External clock counters, layout is shared with dart. drift is a new master position minus the one extrapolated from the previous update
+struct SyncClockStats {
+    int64_t updates;     // master clock updates by dart or native code
+    int64_t reads;       // sync callback calls by mdk
+    int64_t retries;     // reads repeated because of a concurrent update
+    int64_t lastDriftUs; // signed, master is ahead if > 0
+    int64_t maxDriftUs;  // abs
+    int64_t meanDriftUs; // abs
+};
+
+// Time to reach startup milestones since MdkPrepare() in microseconds, -1 if not reached. layout is shared with dart
+struct PlayerStartup {
+    int64_t prepared;     // prepared callback, media is opened and probed
+    int64_t videoDecoder; // first successful "decoder.video" event
+    int64_t firstRender;  // first renderVideo() by texture plugins
+    int64_t firstPresent; // first frame given to flutter
+};
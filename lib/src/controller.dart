@@ -92,9 +92,12 @@ extension FVPControllerExtensions on VideoPlayerController {
   ///
   /// [width] snapshot width. if not set, result is `mediaInfo.video[current_track].codec.width`
   /// [height] snapshot height. if not set, result is `mediaInfo.video[current_track].codec.height`
+  /// [format] and [quality] if set, return encoded image data, e.g. 'jpg', 'png', 'webp'. see [Player.snapshot]
   /// Return rgba data of image size [width]x[height], stride is `width*4`
-  Future<Uint8List?> snapshot({int? width, int? height}) async {
-    return _platform.snapshot(_getId(this), width: width, height: height);
+  Future<Uint8List?> snapshot(
+      {int? width, int? height, String? format, int quality = -1}) async {
+    return _platform.snapshot(_getId(this),
+        width: width, height: height, format: format, quality: quality);
   }
 
   /// Set position range in milliseconds. Can be used by A-B loop.
@@ -41,6 +41,22 @@ class MethodChannelFvp extends FvpPlatform {
     });
   }
 
+  @override
+  Future<bool> resizeTexture(
+      int playerHandle, int textureId, int width, int height) async {
+    try {
+      return await methodChannel.invokeMethod<bool>('ResizeRT', {
+            "player": playerHandle,
+            "texture": textureId,
+            "width": width,
+            "height": height,
+          }) ??
+          false;
+    } on MissingPluginException {
+      return false;
+    }
+  }
+
   @override
   Future<void> setMixWithOthers(bool mixWithOthers) async {
     await methodChannel.invokeMethod('MixWithOthers', {
@@ -41,6 +41,12 @@ abstract class FvpPlatform extends PlatformInterface {
     throw UnimplementedError('releaseTexture() has not been implemented.');
   }
 
+  /// Resize the texture storage and keep [textureId]. Return false if not supported, then the texture must be recreated.
+  Future<bool> resizeTexture(
+      int playerHandle, int textureId, int width, int height) async {
+    return false;
+  }
+
   Future<void> setMixWithOthers(bool mixWithOthers) async {
     throw UnimplementedError('setMixWithOthers() has not been implemented.');
   }
@@ -1,8 +1,10 @@
 // Copyright 2022-2025 Wang Bin. All rights reserved.
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
+import 'dart:convert';
 import 'dart:ffi';
 import 'dart:isolate';
+import 'dart:typed_data';
 import 'package:ffi/ffi.dart';
 
 import 'generated_bindings.dart';
@@ -266,6 +268,79 @@ void setLogHandler(void Function(LogLevel, String)? cb) {
   _GlobalCallbacks.instance.setLogHandler(cb);
 }
 
+/// Filter and batch logs for [setLogHandler] in native code.
+///
+/// Logs more verbose than [level] are discarded in the logging thread. Unlike `setGlobalOption('log', level)`, mdk still generates them.
+/// If [interval] is not zero, logs are queued and delivered in batches by a native thread every [interval], so verbose logs
+/// won't flood the isolate or slow down mdk threads. At most [capacity] lines can be queued(the value of the first call is used),
+/// extra lines are dropped, counted by [droppedLogs], and reported by a warning line.
+void setLogForwarding(
+    {LogLevel level = LogLevel.all,
+    Duration interval = Duration.zero,
+    int capacity = 1024}) {
+  Libfvp.setLogForwarding(level.rawValue, interval.inMilliseconds, capacity);
+}
+
+/// Deliver logs of [setLogHandler] as compact binary messages instead of lists. Off by default.
+void setPackedLogs(bool enable) => Libfvp.setPacked(0, enable ? 1 << 5 : 0);
+
+/// Number of log lines dropped because the queue of [setLogForwarding] is full.
+int get droppedLogs => Libfvp.logDropped();
+
+/// Stream mdk logs and events, state and media status of all players into a memory mapped ring file at [path] of [size] bytes,
+/// for offline analysis with low overhead, e.g. always on in production. Decode the file by fvp_trace_dump in cmake/tools.
+/// Independent of [setLogHandler], but mdk log handler is replaced while tracing. [path] null: stop tracing and restore the log handler.
+/// Return false if failed to create the file.
+bool setTraceFile(String? path, {int size = 16 << 20}) {
+  if (path == null) {
+    return Libfvp.setTraceFile(nullptr, 0);
+  }
+  final p = path.toNativeUtf8();
+  final ret = Libfvp.setTraceFile(p.cast(), size);
+  malloc.free(p);
+  return ret;
+}
+
+/// Record timing spans of player lifecycle and rendering, e.g. prepare, seek, callback reply waits, texture populate and renderVideo.
+/// Recording costs little, the latest spans of each thread are kept.
+void setSpanTracing(bool enable) => Libfvp.setSpanTracing(enable);
+
+/// Write recorded spans as chrome trace json to [path], which can be opened in chrome://tracing or ui.perfetto.dev.
+bool dumpSpans(String path) {
+  final p = path.toNativeUtf8();
+  final ret = Libfvp.dumpSpans(p.cast());
+  malloc.free(p);
+  return ret;
+}
+
+/// Max [bytes] of render targets cached for other players after textures are released, default 128MB. 0 disables the cache.
+/// Only linux and elinux reuse render targets, least recently released ones are deleted if over limit.
+void setRenderTargetPoolLimit(int bytes) =>
+    Libfvp.setRenderTargetPoolLimit(bytes);
+
+/// Phases of [startupHistogram]. A phase ends at a [PlayerStartup] milestone and starts at the latest earlier one.
+/// values are the same as fvp::StartupPhase in stats.h
+enum StartupPhase {
+  open,
+  decoderInit,
+  render,
+  present,
+
+  /// [Player.prepare] to the first frame given to flutter
+  total,
+}
+
+/// Durations of [phase] of all players since launched. Element 0 counts durations less than 1ms,
+/// element i counts [2^(i-1), 2^i) ms, and the last one counts longer durations.
+List<int> startupHistogram(StartupPhase phase) {
+  const buckets = 16;
+  final p = calloc<Int64>(buckets);
+  final n = Libfvp.getStartupHistogram(phase.index, p, buckets);
+  final ret = p.asTypedList(n).toList();
+  calloc.free(p);
+  return ret;
+}
+
 class _GlobalCallbacks {
   static final _receivePort = ReceivePort();
 
@@ -277,15 +352,35 @@ class _GlobalCallbacks {
     // registerType() before registerPort() to ensure no log will be dropped
     Libfvp.registerType(0, 5, false);
     _receivePort.listen((message) {
+      if (message is Uint8List) {
+        // PackedHeader in callbacks.h, then lines of level, size and text
+        final bd = ByteData.sublistView(message);
+        if (bd.getInt32(0, Endian.little) != 5) {
+          return;
+        }
+        for (var o = 16; o + 8 <= message.length;) {
+          final level = bd.getInt32(o, Endian.little);
+          final size = bd.getInt32(o + 4, Endian.little);
+          o += 8;
+          _logCb?.call(
+              LogLevel.from(level),
+              utf8.decode(Uint8List.sublistView(message, o, o + size),
+                  allowMalformed: true));
+          o += size;
+        }
+        return;
+      }
       final type = message[0] as int;
       switch (type) {
         case 5:
           {
-            // log
-            final level = message[1] as int;
-            final msg = message[2] as String;
-            if (_logCb != null) {
-              _logCb!(LogLevel.from(level), msg);
+            // log, [type, level0, text0, level1, text1, ...]
+            for (var i = 1; i + 1 < message.length; i += 2) {
+              final level = message[i] as int;
+              final msg = message[i + 1] as String;
+              if (_logCb != null) {
+                _logCb!(LogLevel.from(level), msg);
+              }
             }
           }
       }
@@ -76,15 +76,84 @@ abstract class Libfvp {
   static final replyType = instance.lookupFunction<
       Void Function(Int64, Int, Pointer<Void>),
       void Function(int, int, Pointer<Void>)>('MdkCallbacksReplyType');
+  static final setReplyMode = instance.lookupFunction<
+      Void Function(Int64, Int, Int, Int, Pointer<Void>),
+      void Function(int, int, int, int, Pointer<Void>)>('MdkCallbacksSetReplyMode');
   static final prepare = instance.lookupFunction<
-      Bool Function(Int64, Int64, Int64, Pointer<Void>, Int64),
-      bool Function(int, int, int, Pointer<Void>, int)>('MdkPrepare');
+      Int64 Function(Int64, Int64, Int64, Pointer<Void>, Int64),
+      int Function(int, int, int, Pointer<Void>, int)>('MdkPrepare');
   static final seek = instance.lookupFunction<
-      Bool Function(Int64, Int64, Int64, Pointer<Void>, Int64),
-      bool Function(int, int, int, Pointer<Void>, int)>('MdkSeek');
+      Int64 Function(Int64, Int64, Int64, Pointer<Void>, Int64),
+      int Function(int, int, int, Pointer<Void>, int)>('MdkSeek');
   static final snapshot = instance.lookupFunction<
-      Bool Function(Int64, Int64, Int, Int, Pointer<Void>, Int64),
-      bool Function(int, int, int, int, Pointer<Void>, int)>('MdkSnapshot');
+      Int64 Function(Int64, Int64, Int, Int, Int, Pointer<Char>, Int,
+          Pointer<Void>, Int64),
+      int Function(int, int, int, int, int, Pointer<Char>, int, Pointer<Void>,
+          int)>('MdkSnapshot');
+  static final setState = instance.lookupFunction<Bool Function(Int64, Int),
+      bool Function(int, int)>('MdkSetState');
+  static final setMedia = instance.lookupFunction<
+      Bool Function(Int64, Pointer<Char>, Int),
+      bool Function(int, Pointer<Char>, int)>('MdkSetMedia');
+  static final setCacheDir = instance.lookupFunction<
+      Void Function(Pointer<Char>),
+      void Function(Pointer<Char>)>('MdkSetCacheDir');
+  static final cancel = instance.lookupFunction<Bool Function(Int64, Int64),
+      bool Function(int, int)>('MdkCancel');
+  static final getPlayerStats = instance.lookupFunction<
+      Bool Function(Int64, Pointer<Void>),
+      bool Function(int, Pointer<Void>)>('MdkGetPlayerStats');
+  static final getPlayerStartup = instance.lookupFunction<
+      Bool Function(Int64, Pointer<Void>),
+      bool Function(int, Pointer<Void>)>('MdkGetPlayerStartup');
+  static final getStartupHistogram = instance.lookupFunction<
+      Int Function(Int, Pointer<Int64>, Int),
+      int Function(int, Pointer<Int64>, int)>('MdkGetStartupHistogram');
+  static final getPlayerStatus = instance.lookupFunction<
+      Pointer<Void> Function(Int64),
+      Pointer<Void> Function(int)>('MdkGetPlayerStatus');
+  static final readPlayerStatus = instance.lookupFunction<
+      Void Function(Pointer<Void>, Pointer<Void>),
+      void Function(Pointer<Void>, Pointer<Void>)>('MdkReadPlayerStatus',
+      isLeaf: true);
+  static final setSyncClock = instance.lookupFunction<
+      Bool Function(Int64, Bool, Int),
+      bool Function(int, bool, int)>('MdkSetSyncClock');
+  static final updateSyncClock = instance.lookupFunction<
+      Void Function(Int64, Double, Double),
+      void Function(int, double, double)>('MdkUpdateSyncClock', isLeaf: true);
+  static final getSyncClockStats = instance.lookupFunction<
+      Bool Function(Int64, Pointer<Void>),
+      bool Function(int, Pointer<Void>)>('MdkGetSyncClockStats');
+  static final thumbnails = instance.lookupFunction<
+      Bool Function(Pointer<Char>, Pointer<Int64>, Int, Int, Int, Int,
+          Pointer<Void>, Int64),
+      bool Function(Pointer<Char>, Pointer<Int64>, int, int, int, int,
+          Pointer<Void>, int)>('MdkThumbnails');
+  static final setCoalescing = instance.lookupFunction<
+      Void Function(Int64, Pointer<Char>, Int),
+      void Function(int, Pointer<Char>, int)>('MdkCallbacksSetCoalescing');
+  static final setLogForwarding = instance.lookupFunction<
+      Void Function(Int, Int, Int),
+      void Function(int, int, int)>('MdkCallbacksSetLogForwarding');
+  static final logDropped = instance.lookupFunction<Int64 Function(),
+      int Function()>('MdkCallbacksLogDropped');
+  static final setTraceFile = instance.lookupFunction<
+      Bool Function(Pointer<Char>, Int64),
+      bool Function(Pointer<Char>, int)>('MdkCallbacksSetTraceFile');
+  static final setRenderTargetPoolLimit = instance.lookupFunction<
+      Void Function(Int64), void Function(int)>('MdkSetRenderTargetPoolLimit');
+  static final setSpanTracing = instance.lookupFunction<Void Function(Bool),
+      void Function(bool)>('MdkSetSpanTracing');
+  static final dumpSpans = instance.lookupFunction<Bool Function(Pointer<Char>),
+      bool Function(Pointer<Char>)>('MdkDumpSpans');
+  static final setPacked = instance.lookupFunction<Void Function(Int64, Int),
+      void Function(int, int)>('MdkCallbacksSetPacked');
+  static final enableEventBatch = instance.lookupFunction<
+      Pointer<Void> Function(Int64, Int),
+      Pointer<Void> Function(int, int)>('MdkCallbacksEnableEventBatch');
+  static final ringCommit = instance.lookupFunction<Int64 Function(Int64, Int64),
+      int Function(int, int)>('MdkCallbacksRingCommit');
   static final isEmulator = instance
       .lookupFunction<Bool Function(), bool Function()>('MdkIsEmulator');
   static final getVid = instance.lookupFunction<Pointer<Void> Function(Int64),
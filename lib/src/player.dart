@@ -2,14 +2,17 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 import 'dart:async';
+import 'dart:convert';
 import 'dart:ffi';
 import 'dart:io';
 import 'dart:isolate';
 import 'dart:math';
+import 'dart:typed_data';
 import 'dart:ui' as ui;
 
 import 'package:ffi/ffi.dart';
 import 'package:flutter/foundation.dart';
+import 'package:path_provider/path_provider.dart';
 import 'package:video_player_platform_interface/video_player_platform_interface.dart';
 
 import 'fvp_platform_interface.dart';
@@ -27,105 +30,10 @@ class Player {
 
   Player() {
     _pp.value = _player;
-    _receivePort.listen((message) async {
-      final type = message[0] as int;
-      final rep = calloc<_CallbackReply>();
-      switch (type) {
-        case 0:
-          {
-            // event
-            final error = message[1] as int;
-            final category = message[2] as String;
-            final detail = message[3] as String;
-            final ev = MediaEvent(error, category, detail);
-            if (_eventCb.hasListener) {
-              _eventCb.add(ev);
-            }
-          }
-        case 1:
-          {
-            // state
-            final oldValue = message[1] as int;
-            final newValue = message[2] as int;
-            if (_stateCb.hasListener) {
-              _stateCb.add((
-                oldValue: PlaybackState.from(oldValue),
-                newValue: PlaybackState.from(newValue)
-              ));
-            }
-            Libfvp.replyType(nativeHandle, type, nullptr);
-          }
-        case 2:
-          {
-            // media status
-            final oldValue = message[1] as int;
-            final newValue = message[2] as int;
-            bool ret = true;
-            if (_statusCb.hasListener) {
-              _statusCb.add((
-                oldValue: MediaStatus(oldValue),
-                newValue: MediaStatus(newValue)
-              ));
-            }
-            rep.ref.mediaStatus.ret = ret;
-            Libfvp.replyType(nativeHandle, type, rep.cast());
-          }
-        case 3:
-          {
-            // prepared
-            final pos = message[1] as int;
-            _live = message[2] as bool;
-            if (!_prepared.isCompleted) {
-              _prepared.complete(pos);
-            }
-            rep.ref.prepared.ret = true;
-            rep.ref.prepared.boost = true;
-            /*
-            // callback can be late if prepare from pos > 0
-            if (_videoSize.isCompleted)
-              _videoSize = Completer<ui.Size?>();
-            if (!_videoSize.isCompleted) {
-              if (pos < 0) {
-                _videoSize.complete(null);
-              } else {
-                _setVideoSize();
-              }
-            }*/
-            if (_prepareCb != null) {
-              rep.ref.prepared.ret = await _prepareCb!();
-              _prepareCb = null;
-            }
-            Libfvp.replyType(nativeHandle, type, rep.cast());
-          }
-        case 6:
-          {
-            // seek
-            final pos = message[1] as int;
-            if (!(_seeked?.isCompleted ?? true)) {
-              _seeked?.complete(pos);
-            }
-            _seeked = null;
-          }
-        case 7:
-          {
-            final data = message[1] as Uint8List; //null?
-            if (!(_snapshot?.isCompleted ?? true)) {
-              _snapshot?.complete(data.isEmpty ? null : data);
-            }
-            _snapshot = null;
-          }
-        case 8:
-          {
-            final start = message[1] as double;
-            final end = message[2] as double;
-            final texts = (message[3] as List).cast<String>();
-            _subtitleCb?.call(start, end, texts);
-          }
-      }
-      calloc.free(rep);
-    });
+    _receivePort.listen(_onMessage);
     Libfvp.registerPort(nativeHandle, NativeApi.postCObject.cast(),
         _receivePort.sendPort.nativePort);
+    _status = Libfvp.getPlayerStatus(nativeHandle).cast();
 
     onStateChanged.listen((event) {
       _state = event.newValue;
@@ -169,6 +77,202 @@ class Player {
     Libfvp.registerType(nativeHandle, 0, false);
   }
 
+  Future<void> _onMessage(dynamic message) async {
+    // records written before this message are handled first
+    _drainRing();
+    if (message is Uint8List) {
+      _onPacked(message);
+      return;
+    }
+    final type = message[0] as int;
+    final rep = calloc<_CallbackReply>();
+    switch (type) {
+      case 0:
+        {
+          // event
+          final error = message[1] as int;
+          final category = message[2] as String;
+          final detail = message[3] as String;
+          final ev = MediaEvent(error, category, detail);
+          if (_eventCb.hasListener) {
+            _eventCb.add(ev);
+          }
+        }
+      case 1:
+        _onState(message[1] as int, message[2] as int);
+      case 2:
+        _onMediaStatus(message[1] as int, message[2] as int, rep);
+      case 3:
+        {
+          // prepared
+          final pos = message[1] as int;
+          final gen = message[3] as int;
+          _prepared.remove(gen)?.complete(pos);
+          // cancelled: native is not waiting for reply
+          if (pos != _prepareCancelled) {
+            if (gen == _prepareGen) {
+              await _onPrepared(message[2] as bool, rep);
+            } else {
+              // superseded by a newer prepare() after native posted the result, stop loading
+              rep.ref.prepared.ret = false;
+            }
+            Libfvp.replyType(nativeHandle, type, rep.cast());
+          }
+        }
+      case 6:
+        _onSeek(message[1] as int, message[2] as int);
+      case 7:
+        {
+          final data = message[1]; // Uint8List, or String if encoding failed
+          if (message[2] as int == _snapshotOp) {
+            if (!(_snapshot?.isCompleted ?? true)) {
+              if (data is String) {
+                _snapshot?.completeError(Exception('snapshot: $data'));
+              } else {
+                _snapshot?.complete(
+                    (data as Uint8List).isEmpty ? null : data);
+              }
+            }
+            _snapshot = null;
+          }
+        }
+      case 8:
+        {
+          final start = message[1] as double;
+          final end = message[2] as double;
+          final texts = (message[3] as List).cast<String>();
+          _subtitleCb?.call(start, end, texts);
+        }
+      case 9:
+        break; // ring is drained above
+    }
+    calloc.free(rep);
+  }
+
+  Future<void> _onPrepared(bool live, Pointer<_CallbackReply> rep) async {
+    _live = live;
+    rep.ref.prepared.ret = true;
+    rep.ref.prepared.boost = true;
+    /*
+    // callback can be late if prepare from pos > 0
+    if (_videoSize.isCompleted)
+      _videoSize = Completer<ui.Size?>();
+    if (!_videoSize.isCompleted) {
+      if (pos < 0) {
+        _videoSize.complete(null);
+      } else {
+        _setVideoSize();
+      }
+    }*/
+    if (_prepareCb != null) {
+      rep.ref.prepared.ret = await _prepareCb!();
+      _prepareCb = null;
+    }
+  }
+
+  void _onState(int oldValue, int newValue) {
+    if (_stateCb.hasListener) {
+      _stateCb.add((
+        oldValue: PlaybackState.from(oldValue),
+        newValue: PlaybackState.from(newValue)
+      ));
+    }
+    Libfvp.replyType(nativeHandle, 1, nullptr);
+  }
+
+  void _onMediaStatus(int oldValue, int newValue, Pointer<_CallbackReply> rep) {
+    bool ret = true;
+    if (_statusCb.hasListener) {
+      _statusCb.add(
+          (oldValue: MediaStatus(oldValue), newValue: MediaStatus(newValue)));
+    }
+    rep.ref.mediaStatus.ret = ret;
+    Libfvp.replyType(nativeHandle, 2, rep.cast());
+  }
+
+  void _onSeek(int pos, int seq) {
+    // results of older seeks are completed with -2 by seek()
+    if (seq != _seekSeq) {
+      return;
+    }
+    if (!(_seeked?.isCompleted ?? true)) {
+      _seeked?.complete(pos);
+    }
+    _seeked = null;
+  }
+
+  // PackedHeader in callbacks.h: type, seq, time, then int64 values
+  void _onPacked(Uint8List message) {
+    final bd = ByteData.sublistView(message);
+    final type = bd.getInt32(0, Endian.little);
+    switch (type) {
+      case 1:
+        _onState(
+            bd.getInt64(16, Endian.little), bd.getInt64(24, Endian.little));
+      case 2:
+        {
+          final rep = calloc<_CallbackReply>();
+          _onMediaStatus(bd.getInt64(16, Endian.little),
+              bd.getInt64(24, Endian.little), rep);
+          calloc.free(rep);
+        }
+      case 6:
+        _onSeek(
+            bd.getInt64(16, Endian.little), bd.getInt64(24, Endian.little));
+    }
+  }
+
+  // records are written by native, [_ringRead, end) is readable until committed
+  void _drainRing() {
+    final ring = _ring;
+    if (ring == null) {
+      return;
+    }
+    final bd = ByteData.sublistView(ring);
+    while (true) {
+      final end = Libfvp.ringCommit(nativeHandle, _ringRead);
+      if (end == _ringRead) {
+        break;
+      }
+      for (; _ringRead < end; ++_ringRead) {
+        final o = (_ringRead % _ringCapacity) * _ringRecordSize;
+        final type = bd.getInt32(o, Endian.host);
+        final size = bd.getInt32(o + 4, Endian.host);
+        final v0 = o + 8;
+        final v1 = o + 16;
+        final texts = size > 0
+            ? utf8
+                .decode(Uint8List.sublistView(ring, o + 32, o + 32 + size),
+                    allowMalformed: true)
+                .split('\u0000')
+            : <String>[];
+        switch (type) {
+          case 0:
+            _onMessage([
+              type,
+              bd.getInt64(v0, Endian.host),
+              texts.isNotEmpty ? texts[0] : '',
+              texts.length > 1 ? texts[1] : ''
+            ]);
+          case 1:
+          case 2:
+            _onMessage([
+              type,
+              bd.getInt64(v0, Endian.host),
+              bd.getInt64(v1, Endian.host)
+            ]);
+          case 8:
+            _onMessage([
+              type,
+              bd.getFloat64(v0, Endian.host),
+              bd.getFloat64(v1, Endian.host),
+              texts
+            ]);
+        }
+      }
+    }
+  }
+
   /// Release resources
   void dispose() async {
     if (_pp == nullptr) {
@@ -177,7 +281,10 @@ class Player {
     }
     // await: ensure no player ref in fvp plugin before mdkPlayerAPI_delete() in dart
     await updateTexture(width: -1);
+    cancel(); // pending prepare() and seek() are not applied to the player being deleted
     state = PlaybackState.stopped;
+    _ring = null;
+    _status = nullptr; // native memory is released with the port
     Libfvp.unregisterPort(nativeHandle);
     _eventCb.close();
     Libfvp.unregisterType(nativeHandle, 0);
@@ -198,42 +305,187 @@ class Player {
   ///
   /// Texture will be created when media is loaded and mediaInfo.video is not empty.
   /// If both [width] and [height] are null, texture size is video frame size, otherwise is requested size.
+  /// If the platform supports resizing(linux, elinux), current texture is resized in place and [textureId] is not changed.
   Future<int> updateTexture(
       {int? width, int? height, bool? tunnel, bool? fit}) async {
-    if ((textureId.value ?? -1) >= 0) {
-      await FvpPlatform.instance.releaseTexture(nativeHandle, textureId.value!);
-      textureId.value = null;
+    final resize = (width == null && height == null) ||
+        (width != null && height != null && width > 0 && height > 0);
+    if (!resize || (tunnel ?? false)) {
+      await _releaseTexture();
+    }
+    if (!resize) {
+      // release texture if width or height <= 0
+      return -1;
     }
     final size = await _videoSize.future;
     if (size == null) {
+      await _releaseTexture();
       return -1;
     }
-    if (width == null && height == null) {
+    if (width == null || height == null) {
       // original size
-      textureId.value = await FvpPlatform.instance.createTexture(nativeHandle,
-          size.width.toInt(), size.height.toInt(), tunnel ?? false);
-      return textureId.value!;
-    }
-    if (width != null && height != null && width > 0 && height > 0) {
-      if (fit ?? true) {
-        final r = size.width / size.height;
-        final w = (height * r).toInt();
-        if (w <= width) {
-          width = w;
-        } else {
-          height = (width / r).toInt();
-        }
+      width = size.width.toInt();
+      height = size.height.toInt();
+    } else if (fit ?? true) {
+      final r = size.width / size.height;
+      final w = (height * r).toInt();
+      if (w <= width) {
+        width = w;
+      } else {
+        height = (width / r).toInt();
+      }
+    }
+    return _createTexture(width, height, tunnel ?? false);
+  }
+
+  /// Create a texture of [width]x[height] before [media] is set, e.g. for a player in `PlayerPool`.
+  /// Video frames are scaled into it. [updateTexture] keeps it on platforms supporting resizing(linux, elinux), otherwise it's recreated.
+  Future<int> prewarmTexture(int width, int height) =>
+      _createTexture(width, height, false);
+
+  Future<int> _createTexture(int width, int height, bool tunnel) async {
+    final tex = textureId.value ?? -1;
+    if (tex >= 0) {
+      if (await FvpPlatform.instance
+          .resizeTexture(nativeHandle, tex, width, height)) {
+        _textureWidth = width;
+        _textureHeight = height;
+        return tex;
+      }
+      await _releaseTexture();
+    }
+    textureId.value = await FvpPlatform.instance
+        .createTexture(nativeHandle, width, height, tunnel);
+    _textureWidth = width;
+    _textureHeight = height;
+    return textureId.value!;
+  }
+
+  Future<void> _releaseTexture() async {
+    if ((textureId.value ?? -1) >= 0) {
+      await FvpPlatform.instance.releaseTexture(nativeHandle, textureId.value!);
+      textureId.value = null;
+    }
+    _textureWidth = 0;
+    _textureHeight = 0;
+  }
+
+  /// Size of current texture, (0, 0) if no texture.
+  ({int width, int height}) get textureStorageSize =>
+      (width: _textureWidth, height: _textureHeight);
+
+  /// Stop playback, clear [media] and restore properties and callbacks set by user to default values, so the player can be reused
+  /// for another media with callbacks port and texture kept, e.g. by `PlayerPool`. Unfinished operations are cancelled, see [cancel].
+  /// Subscriptions of [onEvent], [onStateChanged] and [onMediaStatus] are not cancelled.
+  void reset() {
+    cancel();
+    state = PlaybackState.stopped;
+    onSubtitleText(null);
+    _prepareCb = null;
+    if (_media.isNotEmpty) {
+      media = "";
+    }
+    if (_loop != 0) {
+      loop = 0;
+    }
+    if (_playbackRate != 1.0) {
+      playbackRate = 1.0;
+    }
+    if (_mute) {
+      mute = false;
+    }
+    if (_volume != 1.0) {
+      volume = 1.0;
+    }
+    if (!_preloadImmediately) {
+      preloadImmediately = true;
+    }
+    for (final (type, tracks) in [
+      (MediaType.audio, _activeAT),
+      (MediaType.video, _activeVT),
+      (MediaType.subtitle, _activeST)
+    ]) {
+      if (tracks.length != 1 || tracks[0] != 0) {
+        setActiveTracks(type, [0]);
       }
-      textureId.value = await FvpPlatform.instance
-          .createTexture(nativeHandle, width, height, tunnel ?? false);
-      return textureId.value!;
     }
-    // release texture if width or height <= 0
-    return -1;
   }
 
   Future<ui.Size?> get textureSize => _videoSize.future;
 
+  /// Deliver events of registered callbacks without reply in batches through a preallocated native ring of [capacity] records,
+  /// so many events are handled in 1 isolate message. Native writers take a short lock, dart reads without locking. Events are dropped if the ring is full.
+  /// The ring can not be resized once enabled. Events are still in order, and an event happened before a result of other callbacks,
+  /// e.g. [prepare] and [seek], is delivered before the result, but an event happened later may be delivered earlier.
+  bool enableEventBatching({int capacity = 256}) {
+    if (_ring != null) {
+      return _ringCapacity == capacity;
+    }
+    final p = Libfvp.enableEventBatch(nativeHandle, capacity);
+    if (p == nullptr) {
+      return false;
+    }
+    _ring = p.cast<Uint8>().asTypedList(capacity * _ringRecordSize);
+    _ringCapacity = capacity;
+    return true;
+  }
+
+  /// Accumulated counters of callbacks delivery and texture rendering. Cheap to read, e.g. in a periodic timer.
+  PlayerStats get stats {
+    final p = calloc<_PlayerStats>();
+    final s = Libfvp.getPlayerStats(nativeHandle, p.cast())
+        ? PlayerStats._(p.ref)
+        : const PlayerStats._zero();
+    calloc.free(p);
+    return s;
+  }
+
+  /// Latest status maintained by native code, e.g. for progress bars of many players in every frame.
+  ///
+  /// A copy of all fields from the same native update by a leaf ffi call, w/o messages and locks. The returned value never changes,
+  /// get it again for new values, and compare [PlayerStatus.seq] to skip unchanged players. All fields are 0 after [dispose].
+  PlayerStatus get status {
+    if (_status == nullptr) {
+      return const PlayerStatus._zero();
+    }
+    Libfvp.readPlayerStatus(_status.cast(), _statusCopy.cast());
+    return PlayerStatus._(_statusCopy.ref);
+  }
+
+  /// Time to first frame breakdown of the latest [prepare], null if not prepared.
+  PlayerStartup? get startup {
+    final p = calloc<_PlayerStartup>();
+    final s = Libfvp.getPlayerStartup(nativeHandle, p.cast())
+        ? PlayerStartup._(p.ref)
+        : null;
+    calloc.free(p);
+    return s;
+  }
+
+  /// Slave playback to an external master clock set by [updateSyncClock], e.g. multi-screen sync.
+  ///
+  /// mdk reads the clock from native memory every [minInterval] milliseconds when rendering, no message is sent to dart.
+  /// The clock is paused at 0 until updated. [enable] false: restore the playback clock.
+  bool setSyncClock(bool enable, {int minInterval = 10}) =>
+      Libfvp.setSyncClock(nativeHandle, enable, minInterval);
+
+  /// Set the master clock [position] at now and the [rate] it advances at, 0 if paused.
+  /// Lock free and no message, it's cheap to call for every master clock tick. Native code can update the clock directly,
+  /// see `MdkGetSyncClock()` in callbacks.h.
+  void updateSyncClock(Duration position, {double rate = 1.0}) =>
+      Libfvp.updateSyncClock(
+          nativeHandle, position.inMicroseconds / 1000000.0, rate);
+
+  /// Drift of the master clock set by [updateSyncClock].
+  SyncClockStats get syncClockStats {
+    final p = calloc<_SyncClockStats>();
+    final s = Libfvp.getSyncClockStats(nativeHandle, p.cast())
+        ? SyncClockStats._(p.ref)
+        : const SyncClockStats._zero();
+    calloc.free(p);
+    return s;
+  }
+
   /// Mute the audio or not
   set mute(bool value) {
     _mute = value;
@@ -274,9 +526,12 @@ class Player {
     }
     _media = value;
     final cs = value.toNativeUtf8();
-    _player.ref.setMedia
-            .asFunction<void Function(Pointer<mdkPlayer>, Pointer<Char>)>()(
-        _player.ref.object, cs.cast());
+    // after a pending prepare()
+    if (!Libfvp.setMedia(nativeHandle, cs.cast(), -1)) {
+      _player.ref.setMedia
+              .asFunction<void Function(Pointer<mdkPlayer>, Pointer<Char>)>()(
+          _player.ref.object, cs.cast());
+    }
     malloc.free(cs);
   }
 
@@ -326,8 +581,11 @@ class Player {
   /// https://github.com/wang-bin/mdk-sdk/wiki/Player-APIs#void-setstateplaybackstate-value
   set state(PlaybackState value) {
     _state = value;
-    _player.ref.setState.asFunction<void Function(Pointer<mdkPlayer>, int)>()(
-        _player.ref.object, value.rawValue);
+    // after a pending prepare()
+    if (!Libfvp.setState(nativeHandle, value.rawValue)) {
+      _player.ref.setState.asFunction<void Function(Pointer<mdkPlayer>, int)>()(
+          _player.ref.object, value.rawValue);
+    }
   }
 
   /// Current playback state.
@@ -394,19 +652,69 @@ class Player {
   /// -1: already loading or loaded
   /// -4: requested position out of range
   /// -10: internal error
+  /// -11: cancelled by a newer [prepare] or [cancel]
+  ///
+  /// The previous media is stopped in a native thread, so switching media never blocks the ui.
   Future<int> prepare(
       {int position = 0,
       SeekFlag flags = const SeekFlag(SeekFlag.defaultFlags),
       Future<bool> Function()? callback,
       bool reply = false}) async {
-    _prepared = Completer<int>();
     Libfvp.registerType(nativeHandle, 3, reply);
     _prepareCb = callback;
-    if (!Libfvp.prepare(nativeHandle, position, flags.rawValue,
-        NativeApi.postCObject.cast(), _receivePort.sendPort.nativePort)) {
-      _prepared.complete(-10);
+    final gen = Libfvp.prepare(nativeHandle, position, flags.rawValue,
+        NativeApi.postCObject.cast(), _receivePort.sendPort.nativePort);
+    if (gen == 0) {
+      return -10;
     }
-    return _prepared.future;
+    _prepareGen = gen;
+    final prepared = Completer<int>();
+    _prepared[gen] = prepared;
+    return prepared.future;
+  }
+
+  /// Cancel unfinished [prepare], [seek] and [snapshot], e.g. a user swipes past an item in a feed.
+  ///
+  /// Their futures complete now with -11, -2 and null, and native results are dropped. Loading media is stopped,
+  /// a pending seek is never executed, and copying and encoding a snapshot are skipped.
+  void cancel({bool prepare = true, bool seek = true, bool snapshot = true}) {
+    if (prepare && _prepared.isNotEmpty) {
+      Libfvp.cancel(nativeHandle, _prepareGen);
+      _prepareGen = 0; // reject a result posted before cancelled
+      for (final c in _prepared.values) {
+        c.complete(_prepareCancelled);
+      }
+      _prepared.clear();
+    }
+    if (seek && !(_seeked?.isCompleted ?? true)) {
+      Libfvp.cancel(nativeHandle, _seekSeq);
+      _seekSeq = 0;
+      _seeked!.complete(-2);
+      _seeked = null;
+    }
+    if (snapshot && !(_snapshot?.isCompleted ?? true)) {
+      Libfvp.cancel(nativeHandle, _snapshotOp);
+      _snapshotOp = 0;
+      _snapshot!.complete(null);
+      _snapshot = null;
+    }
+  }
+
+  /// Set how native waits for dart result of [prepare] callback and [onMediaStatus] registered with reply.
+  ///
+  /// [async] false: mdk thread is blocked until dart replies or [timeout], then [fallback] is used.
+  /// [async] true: [fallback] is used immediately so prepare and status transitions never wait for this isolate.
+  /// A false result arrived before [timeout] is applied later by stopping the player.
+  /// [timeout] null: no timeout.
+  void setReplyMode({bool async = false, Duration? timeout, bool fallback = true}) {
+    final rep = calloc<_CallbackReply>();
+    final ms = timeout?.inMilliseconds ?? -1;
+    rep.ref.mediaStatus.ret = fallback;
+    Libfvp.setReplyMode(nativeHandle, 2, async ? 1 : 0, ms, rep.cast());
+    rep.ref.prepared.ret = fallback;
+    rep.ref.prepared.boost = true;
+    Libfvp.setReplyMode(nativeHandle, 3, async ? 1 : 0, ms, rep.cast());
+    calloc.free(rep);
   }
 
   /// Set decoder priority.
@@ -454,9 +762,11 @@ class Player {
   /// https://github.com/wang-bin/mdk-sdk/wiki/Player-APIs#void-setmediaconst-char-url-mediatype-type
   void setMedia(String uri, MediaType type) {
     final cs = uri.toNativeUtf8();
-    _player.ref.setMediaForType.asFunction<
-            void Function(Pointer<mdkPlayer>, Pointer<Char>, int)>()(
-        _player.ref.object, cs.cast(), type.rawValue);
+    if (!Libfvp.setMedia(nativeHandle, cs.cast(), type.rawValue)) {
+      _player.ref.setMediaForType.asFunction<
+              void Function(Pointer<mdkPlayer>, Pointer<Char>, int)>()(
+          _player.ref.object, cs.cast(), type.rawValue);
+    }
     malloc.free(cs);
   }
 
@@ -488,6 +798,9 @@ class Player {
 
   /// Seek to [position] in milliseconds
   /// https://github.com/wang-bin/mdk-sdk/wiki/Player-APIs#bool-seekint64_t-pos-seekflag-flags-stdfunctionvoidint64_t-ret-cb--nullptr
+  ///
+  /// At most 1 seek is in flight, a seek requested before it finishes is pending and replaces the previous pending one, which is never
+  /// executed, counted by [PlayerStats.seeksElided]. The future of a replaced seek completes with -2.
   Future<int> seek(
       {required int position,
       SeekFlag flags = const SeekFlag(SeekFlag.defaultFlags)}) async {
@@ -495,13 +808,22 @@ class Player {
       _seeked?.complete(-2);
     }
     _seeked = Completer<int>();
-    if (!Libfvp.seek(nativeHandle, position, flags.rawValue,
-        NativeApi.postCObject.cast(), _receivePort.sendPort.nativePort)) {
+    _seekSeq = Libfvp.seek(nativeHandle, position, flags.rawValue,
+        NativeApi.postCObject.cast(), _receivePort.sendPort.nativePort);
+    if (_seekSeq == 0) {
       _seeked!.complete(-10);
     }
     return _seeked!.future;
   }
 
+  /// Seek while dragging a slider. Fast key frame seeks are used if [dragging], and an accurate seek for the final position
+  /// when the drag ends. Obsolete positions are dropped, see [seek].
+  Future<int> scrub(int position, {required bool dragging}) => seek(
+      position: position,
+      flags: SeekFlag(dragging
+          ? SeekFlag.fromStart | SeekFlag.keyFrame | SeekFlag.inCache
+          : SeekFlag.fromStart | SeekFlag.inCache));
+
   List<DurationRange> bufferedTimeRanges() {
     const int n = 16;
     final cbytes = calloc<Int64>(2 * n);
@@ -724,22 +1046,119 @@ class Player {
   ///
   /// [width] snapshot width. if not set, result is `mediaInfo.video[current_track].codec.width`
   /// [height] snapshot height. if not set, result is `mediaInfo.video[current_track].codec.height`
-  /// Return rgba data of image size [width]x[height], stride is `width*4`
-  Future<Uint8List?> snapshot({int? width, int? height}) {
+  /// [packed] false: rows keep the stride of the rendered frame to avoid repacking, stride is `data.length/height`
+  /// [format] if set, the image is encoded on a native worker thread, e.g. 'jpg', 'png', 'webp'. [packed] is ignored
+  /// [quality] encoding quality in range [0, 100], -1 is the encoder default
+  /// Return rgba data of image size [width]x[height], stride is `width*4` if [packed], or encoded image data if [format] is set.
+  /// The data is backed by a reusable native buffer, it's recycled when the list is garbage collected.
+  /// The future completes with an error if encoding failed. Encoders write a temporary file in app cache dir.
+  Future<Uint8List?> snapshot(
+      {int? width,
+      int? height,
+      bool packed = true,
+      String? format,
+      int quality = -1}) {
     if (!(_snapshot?.isCompleted ?? true)) {
       _snapshot?.complete(null);
     }
-    _snapshot = Completer<Uint8List?>();
-    if (!Libfvp.snapshot(
+    final completer = Completer<Uint8List?>();
+    _snapshot = completer;
+    if (format == null || _cacheDirSet) {
+      _takeSnapshot(width, height, packed, format, quality);
+    } else {
+      _initCacheDir().then((_) {
+        if (_snapshot == completer && !completer.isCompleted) {
+          _takeSnapshot(width, height, packed, format, quality);
+        }
+      });
+    }
+    return completer.future;
+  }
+
+  static bool _cacheDirSet = false;
+  static Future<void>? _cacheDir;
+
+  static Future<void> _initCacheDir() => _cacheDir ??= () async {
+        String dir;
+        try {
+          dir = (await getTemporaryDirectory()).path;
+        } catch (e) {
+          // no path_provider implementation, e.g. elinux
+          dir = Directory.systemTemp.path;
+        }
+        final cs = dir.toNativeUtf8();
+        Libfvp.setCacheDir(cs.cast());
+        malloc.free(cs);
+        _cacheDirSet = true;
+      }();
+
+  void _takeSnapshot(
+      int? width, int? height, bool packed, String? format, int quality) {
+    final cFormat = format?.toNativeUtf8() ?? nullptr;
+    _snapshotOp = Libfvp.snapshot(
         nativeHandle,
         textureId.value ?? -1,
         width ?? 0,
         height ?? 0,
+        packed ? 0 : 1,
+        cFormat.cast(),
+        quality,
         NativeApi.postCObject.cast(),
-        _receivePort.sendPort.nativePort)) {
+        _receivePort.sendPort.nativePort);
+    if (_snapshotOp == 0) {
       _snapshot!.complete(null);
     }
-    return _snapshot!.future;
+    if (cFormat != nullptr) {
+      malloc.free(cFormat);
+    }
+  }
+
+  /// Decode key frames nearest to [positions] in milliseconds of [url] for a thumbnail strip, no [Player] instance is required.
+  ///
+  /// Frames are decoded in parallel by [workers] headless native players(at most 4, shared by all calls) and scaled to [width]x[height].
+  /// Return rgba data of all frames stacked vertically, i.e. image size [width]x([height]*positions.length), stride is `width*4`,
+  /// and timestamps in milliseconds of decoded frames, -1 if failed and the frame is black. The future completes with an error if the result can not be delivered.
+  static Future<({Uint8List data, Int64List timestamps})?> thumbnails(
+      String url, List<int> positions,
+      {int width = 160, int height = 90, int workers = 4}) {
+    if (positions.isEmpty) {
+      return Future.value(null);
+    }
+    final port = ReceivePort();
+    final result = Completer<({Uint8List data, Int64List timestamps})?>();
+    port.listen((message) {
+      final type = message[0] as int;
+      if (type == 10) {
+        if (message[1] is String) {
+          result.completeError(Exception('thumbnails: ${message[1]}'));
+        } else {
+          result.complete((
+            data: message[2] as Uint8List,
+            timestamps: message[1] as Int64List
+          ));
+        }
+      }
+      port.close();
+    });
+    final cUrl = url.toNativeUtf8();
+    final cPositions = calloc<Int64>(positions.length);
+    cPositions.asTypedList(positions.length).setAll(0, positions);
+    final ok = Libfvp.thumbnails(
+        cUrl.cast(),
+        cPositions,
+        positions.length,
+        width,
+        height,
+        workers,
+        NativeApi.postCObject.cast(),
+        port.sendPort.nativePort);
+    malloc.free(cUrl);
+    calloc.free(cPositions);
+    if (!ok) {
+      port.close();
+      result.complete(null);
+    }
+    return result.future;
   }
   // callbacks
 
@@ -758,6 +1177,19 @@ class Player {
   Stream<({MediaStatus oldValue, MediaStatus newValue})> get onMediaStatus =>
       _statusCb.stream;
 
+  /// Deliver state, media status and seek results as compact binary messages instead of lists, i.e. less serialization and no
+  /// casts in this isolate. Off by default.
+  void setPackedMessages(bool enable) => Libfvp.setPacked(
+      nativeHandle, enable ? (1 << 1) | (1 << 2) | (1 << 6) : 0);
+
+  /// Deliver only the latest [MediaEvent] of [category], e.g. 'reader.buffering', at most once per [intervalMs] to reduce isolate wake-ups.
+  /// [intervalMs] <= 0 removes coalescing for [category].
+  void coalesceEvents(String category, int intervalMs) {
+    final cs = category.toNativeUtf8();
+    Libfvp.setCoalescing(nativeHandle, cs.cast(), intervalMs);
+    malloc.free(cs);
+  }
+
   void onSubtitleText(
       void Function(double start, double end, List<String> text)? callback) {
     _subtitleCb = callback;
@@ -814,10 +1246,20 @@ class Player {
 
   bool _live = false;
   var _videoSize = Completer<ui.Size?>();
-  var _prepared = Completer<int>();
+  final _prepared = <int, Completer<int>>{}; // by generation returned by native prepare
+  int _prepareGen = 0;
+  static const _prepareCancelled = -11;
   Completer<Uint8List?>? _snapshot;
+  int _snapshotOp = 0;
   Completer<int>? _seeked;
+  int _seekSeq = 0;
   final _receivePort = ReceivePort();
+  static const _ringRecordSize = 256; // sizeof(CallbackRecord)
+  Uint8List? _ring;
+  Pointer<_PlayerStatus> _status = nullptr; // native, valid until dispose()
+  static final _statusCopy = calloc<_PlayerStatus>(); // read by status getter, all players are in the same isolate
+  int _ringCapacity = 0;
+  int _ringRead = 0;
 
   final _eventCb = StreamController<MediaEvent>.broadcast();
   final _stateCb = StreamController<
@@ -836,6 +1278,8 @@ class Player {
   List<int> _activeVT = [0];
   List<int> _activeST = [0];
   PlaybackState _state = PlaybackState.stopped;
+  int _textureWidth = 0;
+  int _textureHeight = 0;
   int _loop = 0;
   bool _preloadImmediately = true;
   double _playbackRate = 1.0;
@@ -843,6 +1287,269 @@ class Player {
       nullptr; // MediaInfo has views on mdkMediaInfo
 }
 
+/// Accumulated counters of a [Player].
+class PlayerStats {
+  /// Messages and ring records delivered to dart.
+  final int eventsPosted;
+
+  /// Failures to post messages to dart.
+  final int postErrors;
+
+  /// Events dropped because the event ring is full.
+  final int eventsDropped;
+
+  /// Native callbacks blocked to wait for dart replies, and total blocked time.
+  final int replyWaits;
+  final Duration replyWaitTime;
+
+  /// renderVideo() calls in texture plugins, and total time.
+  final int renderCalls;
+  final Duration renderTime;
+
+  /// New frames given to flutter.
+  final int framesPresented;
+
+  /// Repaints without a new frame, the texture is reused.
+  final int renderSkipped;
+
+  /// [Player.seek] calls, and seeks never executed because a newer one replaced them.
+  final int seeksRequested;
+  final int seeksElided;
+
+  PlayerStats._(_PlayerStats s)
+      : eventsPosted = s.eventsPosted,
+        postErrors = s.postErrors,
+        eventsDropped = s.eventsDropped,
+        replyWaits = s.replyWaits,
+        replyWaitTime = Duration(microseconds: s.replyWaitUs),
+        renderCalls = s.renderCalls,
+        renderTime = Duration(microseconds: s.renderUs),
+        framesPresented = s.framesPresented,
+        renderSkipped = s.renderSkipped,
+        seeksRequested = s.seeksRequested,
+        seeksElided = s.seeksElided;
+
+  const PlayerStats._zero()
+      : eventsPosted = 0,
+        postErrors = 0,
+        eventsDropped = 0,
+        replyWaits = 0,
+        replyWaitTime = Duration.zero,
+        renderCalls = 0,
+        renderTime = Duration.zero,
+        framesPresented = 0,
+        renderSkipped = 0,
+        seeksRequested = 0,
+        seeksElided = 0;
+
+  @override
+  String toString() =>
+      'PlayerStats(events: $eventsPosted, postErrors: $postErrors, dropped: $eventsDropped, '
+      'replyWaits: $replyWaits/$replyWaitTime, render: $renderCalls/$renderTime, '
+      'presented: $framesPresented, skipped: $renderSkipped, '
+      'seeks: $seeksRequested, elided: $seeksElided)';
+}
+
+/// Time to reach startup milestones since [Player.prepare], null if not reached yet.
+class PlayerStartup {
+  /// Media is opened and probed, i.e. the prepared callback.
+  final Duration? prepared;
+
+  /// The first video decoder is opened.
+  final Duration? videoDecoder;
+
+  /// The first frame is rendered by texture plugins.
+  final Duration? firstRender;
+
+  /// The first frame is given to flutter.
+  final Duration? firstPresent;
+
+  PlayerStartup._(_PlayerStartup s)
+      : prepared = _since(s.prepared),
+        videoDecoder = _since(s.videoDecoder),
+        firstRender = _since(s.firstRender),
+        firstPresent = _since(s.firstPresent);
+
+  static Duration? _since(int us) =>
+      us < 0 ? null : Duration(microseconds: us);
+
+  @override
+  String toString() =>
+      'PlayerStartup(prepared: $prepared, videoDecoder: $videoDecoder, '
+      'firstRender: $firstRender, firstPresent: $firstPresent)';
+}
+
+/// Status of a player, see [Player.status].
+///
+/// Updated by mdk callbacks on all platforms. [renderTime] is set by texture plugins of linux, elinux and windows only.
+/// All fields are from the same native update.
+class PlayerStatus {
+  /// Increased after each native update.
+  final int seq;
+
+  /// Milliseconds. Timestamp of the latest video frame given to renderers, or [Player.position] when prepared, seeked and state changed.
+  /// Audio only media is updated by state changes and seeks only.
+  final int position;
+
+  /// Milliseconds.
+  final int buffered;
+
+  /// Milliseconds.
+  final int duration;
+
+  /// Microseconds since epoch when the latest frame is rendered by texture plugins, 0 if not rendered or not supported by the platform.
+  final int renderTime;
+
+  /// Frame rate of the first video stream.
+  final double fps;
+
+  final PlaybackState state;
+  final MediaStatus mediaStatus;
+  final int videoWidth;
+  final int videoHeight;
+
+  PlayerStatus._(_PlayerStatus s)
+      : seq = s.seq,
+        position = s.position,
+        buffered = s.buffered,
+        duration = s.duration,
+        renderTime = s.renderTime,
+        fps = s.fps,
+        state = PlaybackState.from(s.state),
+        mediaStatus = MediaStatus(s.mediaStatus),
+        videoWidth = s.videoWidth,
+        videoHeight = s.videoHeight;
+
+  const PlayerStatus._zero()
+      : seq = 0,
+        position = 0,
+        buffered = 0,
+        duration = 0,
+        renderTime = 0,
+        fps = 0,
+        state = PlaybackState.notRunning,
+        mediaStatus = const MediaStatus(0),
+        videoWidth = 0,
+        videoHeight = 0;
+}
+
+// struct fvp::PlayerStatus in stats.h
+final class _PlayerStatus extends Struct {
+  @Int64()
+  external int seq;
+  @Int64()
+  external int position;
+  @Int64()
+  external int buffered;
+  @Int64()
+  external int duration;
+  @Int64()
+  external int renderTime;
+  @Double()
+  external double fps;
+  @Int32()
+  external int state;
+  @Int32()
+  external int mediaStatus;
+  @Int32()
+  external int videoWidth;
+  @Int32()
+  external int videoHeight;
+}
+
+/// Counters of [Player.setSyncClock]. Drift is a new master position minus the one extrapolated from the previous update,
+/// i.e. error of the local clock between master updates, or a master seek.
+class SyncClockStats {
+  /// Master clock updates by dart or native code.
+  final int updates;
+
+  /// Clock reads by mdk when rendering.
+  final int reads;
+
+  /// Reads repeated because of a concurrent update.
+  final int retries;
+
+  /// Master is ahead if positive.
+  final Duration lastDrift;
+  final Duration maxDrift;
+  final Duration meanDrift;
+
+  SyncClockStats._(_SyncClockStats s)
+      : updates = s.updates,
+        reads = s.reads,
+        retries = s.retries,
+        lastDrift = Duration(microseconds: s.lastDriftUs),
+        maxDrift = Duration(microseconds: s.maxDriftUs),
+        meanDrift = Duration(microseconds: s.meanDriftUs);
+
+  const SyncClockStats._zero()
+      : updates = 0,
+        reads = 0,
+        retries = 0,
+        lastDrift = Duration.zero,
+        maxDrift = Duration.zero,
+        meanDrift = Duration.zero;
+
+  @override
+  String toString() =>
+      'SyncClockStats(updates: $updates, reads: $reads, retries: $retries, '
+      'drift: $lastDrift, max: $maxDrift, mean: $meanDrift)';
+}
+
+// struct SyncClockStats in callbacks.h
+final class _SyncClockStats extends Struct {
+  @Int64()
+  external int updates;
+  @Int64()
+  external int reads;
+  @Int64()
+  external int retries;
+  @Int64()
+  external int lastDriftUs;
+  @Int64()
+  external int maxDriftUs;
+  @Int64()
+  external int meanDriftUs;
+}
+
+// struct PlayerStartup in callbacks.h
+final class _PlayerStartup extends Struct {
+  @Int64()
+  external int prepared;
+  @Int64()
+  external int videoDecoder;
+  @Int64()
+  external int firstRender;
+  @Int64()
+  external int firstPresent;
+}
+
+// struct PlayerStats in callbacks.h
+final class _PlayerStats extends Struct {
+  @Int64()
+  external int eventsPosted;
+  @Int64()
+  external int postErrors;
+  @Int64()
+  external int eventsDropped;
+  @Int64()
+  external int replyWaits;
+  @Int64()
+  external int replyWaitUs;
+  @Int64()
+  external int renderCalls;
+  @Int64()
+  external int renderUs;
+  @Int64()
+  external int framesPresented;
+  @Int64()
+  external int renderSkipped;
+  @Int64()
+  external int seeksRequested;
+  @Int64()
+  external int seeksElided;
+}
+
 final class _CallbackReply extends Union {
   external _UnnamedStruct5 mediaStatus;
   external _UnnamedStruct6 sync1;
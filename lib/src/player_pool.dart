@@ -0,0 +1,128 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+import 'dart:async';
+
+import 'player.dart';
+
+/// Pre-constructed [Player]s for instant startup, e.g. in a feed.
+///
+/// Creating a player, registering its callbacks port and creating a texture in the platform plugin take time.
+/// A pool does them ahead for [size] idle players, textures are created for [textureSizes] in turn.
+/// [acquire] hands out an idle player, and [release] recycles it by [Player.reset] instead of disposing.
+/// Idle players not acquired in [idleTimeout] are disposed, then the pool is refilled on next [acquire].
+class PlayerPool {
+  PlayerPool(
+      {this.size = 2,
+      this.textureSizes = const [],
+      this.idleTimeout = const Duration(minutes: 1)});
+
+  /// Max idle players.
+  final int size;
+
+  /// Texture sizes of prewarmed players, e.g. common video sizes of a feed.
+  final List<({int width, int height})> textureSizes;
+
+  /// Idle players are disposed after [idleTimeout]. Duration.zero: never.
+  final Duration idleTimeout;
+
+  /// Number of idle players.
+  int get idle => _idle.length;
+
+  /// Create idle players until [size] players are ready.
+  Future<void> prewarm() async {
+    final tasks = <Future<void>>[];
+    while (_idle.length + _creating < size) {
+      tasks.add(_create(_next++));
+    }
+    await Future.wait(tasks);
+  }
+
+  /// Take an idle player, or create a new one if no player is idle. A player whose texture is [width]x[height] is preferred,
+  /// and [Player.updateTexture] with the same size reuses the texture on platforms supporting resizing(linux, elinux).
+  /// The pool is refilled in background.
+  Player acquire({int? width, int? height}) {
+    _IdlePlayer? item;
+    if (width != null && height != null) {
+      for (final i in _idle) {
+        final s = i.player.textureStorageSize;
+        if (s.width == width && s.height == height) {
+          item = i;
+          break;
+        }
+      }
+    }
+    item ??= _idle.isEmpty ? null : _idle.first;
+    final Player player;
+    if (item == null) {
+      player = Player();
+    } else {
+      _idle.remove(item);
+      item.timer?.cancel();
+      player = item.player;
+    }
+    if (!_closed) {
+      prewarm();
+    }
+    return player;
+  }
+
+  /// Recycle a player from [acquire], or dispose it if the pool is full or closed.
+  /// The texture is kept for the next user.
+  void release(Player player) {
+    if (_closed || _idle.length >= size) {
+      player.dispose();
+      return;
+    }
+    player.reset();
+    _addIdle(player);
+  }
+
+  /// Dispose idle players. Players acquired are not affected, and [release] will dispose them.
+  void dispose() {
+    _closed = true;
+    for (final i in _idle) {
+      i.timer?.cancel();
+      i.player.dispose();
+    }
+    _idle.clear();
+  }
+
+  Future<void> _create(int index) async {
+    ++_creating;
+    final player = Player();
+    if (textureSizes.isNotEmpty) {
+      final s = textureSizes[index % textureSizes.length];
+      await player.prewarmTexture(s.width, s.height);
+    }
+    --_creating;
+    if (_closed || _idle.length >= size) {
+      player.dispose();
+      return;
+    }
+    _addIdle(player);
+  }
+
+  void _addIdle(Player player) {
+    final item = _IdlePlayer(player);
+    if (idleTimeout > Duration.zero) {
+      item.timer = Timer(idleTimeout, () {
+        if (_idle.remove(item)) {
+          player.dispose();
+        }
+      });
+    }
+    _idle.add(item);
+  }
+
+  final _idle = <_IdlePlayer>[];
+  int _creating = 0;
+  int _next = 0;
+  bool _closed = false;
+}
+
+class _IdlePlayer {
+  _IdlePlayer(this.player);
+  final Player player;
+  Timer? timer;
+}
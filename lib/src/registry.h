@@ -0,0 +1,107 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace fvp {
+
+// Thread safe map from handle(player handle or texture id) to object.
+// Keys are spread into shards by hash, and each shard has it's own lock, so lookups from dart ffi calls,
+// mdk threads and platform threads are concurrent unless they hit the same shard while it's being modified.
+template<typename T, int ShardBits = 4>
+class Registry
+{
+public:
+    std::shared_ptr<T> get(int64_t key) const {
+        const auto& s = shard(key);
+        std::shared_lock lock(s.mtx);
+        if (const auto it = s.map.find(key); it != s.map.cend())
+            return it->second;
+        return {};
+    }
+
+    void set(int64_t key, std::shared_ptr<T> value) {
+        auto& s = shard(key);
+        std::shared_ptr<T> old; // destroy outside the lock, destructor may access registry
+        std::scoped_lock lock(s.mtx);
+        old = std::exchange(s.map[key], std::move(value));
+    }
+
+    // return the existing object, or insert a default constructed one
+    std::shared_ptr<T> getOrCreate(int64_t key) {
+        if (auto value = get(key))
+            return value;
+        auto& s = shard(key);
+        std::scoped_lock lock(s.mtx);
+        auto& value = s.map[key];
+        if (!value)
+            value = std::make_shared<T>();
+        return value;
+    }
+
+    // remove and return the object. the object is not destroyed in lock
+    std::shared_ptr<T> take(int64_t key) {
+        auto& s = shard(key);
+        std::scoped_lock lock(s.mtx);
+        const auto it = s.map.find(key);
+        if (it == s.map.end())
+            return {};
+        auto value = std::move(it->second);
+        s.map.erase(it);
+        return value;
+    }
+
+    bool erase(int64_t key) {
+        return !!take(key);
+    }
+
+    size_t size() const {
+        size_t n = 0;
+        for (const auto& s : shards_) {
+            std::shared_lock lock(s.mtx);
+            n += s.map.size();
+        }
+        return n;
+    }
+
+    template<typename F>
+    void forEach(F&& f) const {
+        for (const auto& s : shards_) {
+            std::shared_lock lock(s.mtx);
+            for (const auto& [k, v] : s.map)
+                f(k, v);
+        }
+    }
+
+    void clear() {
+        for (auto& s : shards_) {
+            std::unordered_map<int64_t, std::shared_ptr<T>> m;
+            std::scoped_lock lock(s.mtx);
+            m.swap(s.map);
+        }
+    }
+
+private:
+    struct Shard {
+        mutable std::shared_mutex mtx;
+        std::unordered_map<int64_t, std::shared_ptr<T>> map;
+    };
+
+    // handles are usually aligned pointers, texture ids are small sequential integers. mix all bits
+    static size_t index(int64_t key) {
+        return size_t((uint64_t(key) * 0x9E3779B97F4A7C15ull) >> (64 - ShardBits));
+    }
+    Shard& shard(int64_t key) { return shards_[index(key)]; }
+    const Shard& shard(int64_t key) const { return shards_[index(key)]; }
+
+    Shard shards_[1 << ShardBits];
+};
+
+} // namespace fvp
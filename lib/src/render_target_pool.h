@@ -0,0 +1,111 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Render targets released by texture plugins are cached by size and reused by other players of the same gl context, instead of
+// deleting and allocating gl objects in raster thread for every player in a feed. Least recently released targets are deleted
+// if cached bytes exceed renderTargetPoolLimit().
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace fvp {
+
+// max bytes cached by each pool, 0 to disable caching. defined in callbacks.cpp
+std::atomic<int64_t>& renderTargetPoolLimit();
+
+// T is cheap to move, e.g. gl object names. all methods can be called from any thread, deleter is called in release() and clear(),
+// so the gl context of the pool must be current there
+template<typename T>
+class RenderTargetPool
+{
+public:
+    using Deleter = std::function<void(T&)>;
+
+    explicit RenderTargetPool(Deleter deleter) : deleter_(std::move(deleter)) {}
+
+    // the pool of a gl context, created on first use and alive until exit. deleter is used only when the pool is created
+    static RenderTargetPool& of(const void* context, Deleter deleter) {
+        static std::mutex mtx;
+        static auto pools = new std::unordered_map<const void*, std::unique_ptr<RenderTargetPool>>();
+        std::scoped_lock lock(mtx);
+        auto& p = (*pools)[context];
+        if (!p)
+            p = std::make_unique<RenderTargetPool>(std::move(deleter));
+        return *p;
+    }
+
+    // take a cached target of w x h, the most recently released one first
+    std::optional<T> acquire(int w, int h) {
+        std::scoped_lock lock(mtx_);
+        for (auto it = cached_.begin(); it != cached_.end(); ++it) {
+            if (it->width == w && it->height == h) {
+                auto t = std::move(it->target);
+                bytes_ -= it->bytes;
+                cached_.erase(it);
+                ++hits_;
+                return t;
+            }
+        }
+        ++misses_;
+        return {};
+    }
+
+    // cache a target of w x h using bytes of memory, then delete the least recently released ones if over limit
+    void release(int w, int h, int64_t bytes, T target) {
+        std::vector<T> evicted;
+        {
+            std::scoped_lock lock(mtx_);
+            cached_.push_front({ w, h, bytes, std::move(target) });
+            bytes_ += bytes;
+            const auto limit = renderTargetPoolLimit().load(std::memory_order_relaxed);
+            while (!cached_.empty() && bytes_ > limit) {
+                bytes_ -= cached_.back().bytes;
+                evicted.push_back(std::move(cached_.back().target));
+                cached_.pop_back();
+            }
+        }
+        for (auto& t : evicted)
+            deleter_(t);
+    }
+
+    void clear() {
+        std::list<Entry> cached;
+        {
+            std::scoped_lock lock(mtx_);
+            cached.swap(cached_);
+            bytes_ = 0;
+        }
+        for (auto& e : cached)
+            deleter_(e.target);
+    }
+
+    int64_t bytes() const { std::scoped_lock lock(mtx_); return bytes_; }
+    size_t size() const { std::scoped_lock lock(mtx_); return cached_.size(); }
+    int64_t hits() const { std::scoped_lock lock(mtx_); return hits_; }
+    int64_t misses() const { std::scoped_lock lock(mtx_); return misses_; }
+
+private:
+    struct Entry {
+        int width;
+        int height;
+        int64_t bytes;
+        T target;
+    };
+
+    const Deleter deleter_;
+    mutable std::mutex mtx_;
+    std::list<Entry> cached_; // front: the most recently released
+    int64_t bytes_ = 0;
+    int64_t hits_ = 0;
+    int64_t misses_ = 0;
+};
+
+} // namespace fvp
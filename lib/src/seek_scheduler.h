@@ -0,0 +1,100 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Coalesce seek requests of a player, e.g. dragging a slider. At most 1 seek is in flight, and only the latest request is
+// pending, older pending ones are elided. A relative request is merged into the pending one so no offset is lost.
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+namespace fvp {
+
+class SeekScheduler
+{
+public:
+    // mdk::SeekFlag values
+    static constexpr int kFrom0 = 1;
+    static constexpr int kFromStart = 1 << 1;
+    static constexpr int kFromNow = 1 << 2;
+    static constexpr int kFrame = 1 << 6; // position is frame count
+
+    // elided is increased for every request never issued because a newer one replaced it, e.g. PlayerCounters::seeksElided
+    explicit SeekScheduler(std::atomic<int64_t>& elided) : elided_(elided) {}
+
+    struct Request {
+        int64_t position;
+        int flags;
+        int64_t seq; // identify the result
+    };
+
+    // return true if r must be issued now, otherwise it's pending until the in-flight seek is finished
+    bool request(const Request& r) {
+        std::scoped_lock lock(mtx_);
+        if (!inFlight_) {
+            inFlight_ = r.seq;
+            return true;
+        }
+        if (!pending_) {
+            pending_ = r;
+            return false;
+        }
+        elided_.fetch_add(1, std::memory_order_relaxed);
+        auto& p = *pending_;
+        // "now" of a relative request is the pending target when it's issued
+        if ((r.flags & kFromNow) && (p.flags & kFrame) == (r.flags & kFrame)) {
+            p.position += r.position;
+            if (p.flags & kFromNow)
+                p.flags = r.flags;
+            else // keep the origin of an absolute pending target
+                p.flags = (r.flags & ~kFromNow) | (p.flags & (kFrom0 | kFromStart));
+            p.seq = r.seq;
+            return false;
+        }
+        p = r;
+        return false;
+    }
+
+    // called when the in-flight seek of seq is finished, or failed to issue. return the pending request which is in flight now.
+    // the result of seq is obsolete if a request is returned
+    std::optional<Request> finished(int64_t seq) {
+        std::scoped_lock lock(mtx_);
+        if (inFlight_ != seq) // reset
+            return {};
+        inFlight_ = 0;
+        if (!pending_)
+            return {};
+        auto r = *pending_;
+        pending_.reset();
+        inFlight_ = r.seq;
+        return r;
+    }
+
+    // drop the pending request if it's seq or older. return true if dropped
+    bool cancel(int64_t seq) {
+        std::scoped_lock lock(mtx_);
+        if (!pending_ || pending_->seq > seq)
+            return false;
+        pending_.reset();
+        return true;
+    }
+
+    // forget the in-flight and pending requests, e.g. media is changed. return the pending one which is never issued
+    std::optional<Request> reset() {
+        std::scoped_lock lock(mtx_);
+        inFlight_ = 0;
+        auto r = pending_;
+        pending_.reset();
+        return r;
+    }
+
+private:
+    std::mutex mtx_;
+    int64_t inFlight_ = 0; // seq, 0 if none
+    std::optional<Request> pending_;
+    std::atomic<int64_t>& elided_;
+};
+
+} // namespace fvp
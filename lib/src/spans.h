@@ -0,0 +1,142 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Timing spans of player lifecycle and rendering, e.g. prepare, reply waits, populate, renderVideo, exported as chrome trace json
+// (chrome://tracing, ui.perfetto.dev). Off by default, then a span costs 1 relaxed load. When on, spans are written into per thread
+// rings w/o locks, and the latest spans of each thread are dumped on demand.
+#pragma once
+#include "trace.h" // currentThreadId()
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace fvp {
+
+struct Span {
+    const char* name; // string literal
+    int64_t player;   // player handle, 0 if not related to a player
+    int64_t begin;    // us, steady clock
+    int64_t duration; // us
+    uint32_t tid;
+};
+
+class SpanRecorder
+{
+public:
+    static constexpr size_t kCapacity = 2048; // per thread
+
+    // intentionally leaked, spans can be recorded on exit
+    static SpanRecorder& instance() {
+        static auto r = new SpanRecorder();
+        return *r;
+    }
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+    void setEnabled(bool value) { enabled_ = value; }
+
+    // begin and end are now() values, may be in different threads
+    void record(const char* name, int64_t player, int64_t begin, int64_t end) {
+        if (!enabled())
+            return;
+        auto b = threadBuffer();
+        const auto w = b->write.load(std::memory_order_relaxed);
+        b->spans[w % kCapacity] = Span{ name, player, begin, end - begin, b->tid };
+        b->write.store(w + 1, std::memory_order_release);
+    }
+
+    // write chrome trace json. return false if failed to write path
+    bool dump(const char* path) {
+        std::ofstream f(path);
+        if (!f)
+            return false;
+        f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        char player[32];
+        std::scoped_lock lock(mtx_);
+        for (const auto& b : buffers_) {
+            const auto w = b->write.load(std::memory_order_acquire);
+            for (auto i = w > kCapacity ? w - kCapacity : 0; i < w; ++i) {
+                const auto s = b->spans[i % kCapacity]; // the oldest ones can be overwritten while dumping
+                f << (first ? "" : ",") << "\n{\"name\":\"" << s.name << "\",\"cat\":\"fvp\",\"ph\":\"X\",\"ts\":" << s.begin
+                  << ",\"dur\":" << s.duration << ",\"pid\":1,\"tid\":" << s.tid;
+                if (s.player) {
+                    snprintf(player, sizeof(player), "%#llx", (unsigned long long)s.player);
+                    f << ",\"args\":{\"player\":\"" << player << "\"}";
+                }
+                f << '}';
+                first = false;
+            }
+        }
+        f << "\n]}\n";
+        return f.good();
+    }
+
+private:
+    struct Buffer {
+        uint32_t tid = 0;
+        std::atomic<bool> used = false;
+        std::atomic<uint64_t> write = 0;
+        Span spans[kCapacity];
+    };
+
+    // a buffer is reused by a new thread after the owner thread exits, spans of the old thread are kept until overwritten
+    Buffer* threadBuffer() {
+        struct Holder {
+            Buffer* buffer = nullptr;
+            ~Holder() {
+                if (buffer)
+                    buffer->used = false;
+            }
+        };
+        thread_local Holder h;
+        if (h.buffer)
+            return h.buffer;
+        std::scoped_lock lock(mtx_);
+        for (const auto& b : buffers_) {
+            if (!b->used) {
+                h.buffer = b.get();
+                break;
+            }
+        }
+        if (!h.buffer)
+            h.buffer = buffers_.emplace_back(new Buffer()).get();
+        h.buffer->used = true;
+        h.buffer->tid = currentThreadId();
+        return h.buffer;
+    }
+
+    std::atomic<bool> enabled_ = false;
+    std::mutex mtx_;
+    std::vector<std::unique_ptr<Buffer>> buffers_;
+};
+
+// record the scope as a span if recording is enabled when constructed
+class ScopedSpan
+{
+public:
+    ScopedSpan(const char* name, int64_t player = 0)
+        : name_(SpanRecorder::instance().enabled() ? name : nullptr)
+        , player_(player)
+        , begin_(name_ ? SpanRecorder::now() : 0) {}
+    ~ScopedSpan() {
+        if (name_)
+            SpanRecorder::instance().record(name_, player_, begin_, SpanRecorder::now());
+    }
+
+private:
+    const char* name_;
+    int64_t player_;
+    int64_t begin_;
+};
+
+} // namespace fvp
@@ -0,0 +1,213 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+
+namespace fvp {
+
+// Startup milestones of a player, timestamps are in StartupMarks
+enum StartupMark {
+    Prepare,      // MdkPrepare() called
+    Prepared,     // prepared callback, media is opened and probed
+    VideoDecoder, // first successful "decoder.video" event
+    FirstRender,  // first renderVideo() call by texture plugins
+    FirstPresent, // first frame given to flutter
+    MarkCount,
+};
+
+// Durations aggregated over players. A phase ends at a mark and starts at the latest earlier mark, Total is from Prepare to FirstPresent
+enum StartupPhase {
+    Open,        // Prepare => Prepared
+    DecoderInit, // => VideoDecoder
+    Render,      // => FirstRender
+    Present,     // => FirstPresent
+    Total,
+    PhaseCount,
+};
+
+// log2 buckets of milliseconds: [0, 1), [1, 2), [2, 4) ... [2^(kBuckets-2), inf)
+struct StartupHistogram {
+    static constexpr int kBuckets = 16;
+
+    static int bucketOf(int64_t us) {
+        int b = 0;
+        for (auto ms = us / 1000; ms > 0 && b < kBuckets - 1; ms >>= 1)
+            ++b;
+        return b;
+    }
+
+    void add(int phase, int64_t us) {
+        counts[phase][bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::atomic<int64_t> counts[PhaseCount][kBuckets] = {};
+};
+
+// global histogram of all players. defined in callbacks.cpp
+StartupHistogram& startupHistogram();
+
+// Latest status of a player for ui polling w/o messages, e.g. progress bars of all players on screen in every frame. Layout is shared
+// with dart, which copies it by MdkReadPlayerStatus(). A seqlock: seq is odd while a StatusWriter updates fields, and increased by 2 after an
+// update. Readers read seq, fields and seq again, and retry if seq is odd or changed, see readStatus(). Unchanged players can be skipped by seq.
+// Updated on all platforms by mdk callbacks, except renderTime which is set by linux, elinux and windows texture plugins only.
+struct PlayerStatus {
+    std::atomic<int64_t> seq = 0;
+    std::atomic<int64_t> position = 0;    // ms, of the latest video frame delivered to renderers, or mdk position when prepared, seeked and state changed
+    std::atomic<int64_t> buffered = 0;    // ms
+    std::atomic<int64_t> duration = 0;    // ms
+    std::atomic<int64_t> renderTime = 0;  // us since epoch when the latest frame is rendered by texture plugins, 0 if not rendered or not supported
+    std::atomic<double> fps = 0;          // frame rate of the first video stream
+    std::atomic<int32_t> state = 0;       // mdk::State
+    std::atomic<int32_t> mediaStatus = 0; // mdk::MediaStatus
+    std::atomic<int32_t> videoWidth = 0;
+    std::atomic<int32_t> videoHeight = 0;
+};
+static_assert(std::atomic<int64_t>::is_always_lock_free && std::atomic<double>::is_always_lock_free && sizeof(PlayerStatus) == 64,
+              "PlayerStatus is copied as plain memory for dart");
+
+// Always on counters of a player. Updated by callbacks bridge and texture plugins w/o locks, read by MdkGetPlayerStats()
+struct PlayerCounters {
+    std::atomic<int64_t> eventsPosted = 0;
+    std::atomic<int64_t> postErrors = 0;
+    std::atomic<int64_t> eventsDropped = 0;
+    std::atomic<int64_t> replyWaits = 0;
+    std::atomic<int64_t> replyWaitUs = 0;
+    std::atomic<int64_t> renderCalls = 0;
+    std::atomic<int64_t> renderUs = 0;
+    std::atomic<int64_t> framesPresented = 0;
+    std::atomic<int64_t> renderSkipped = 0;
+    std::atomic<int64_t> seeksRequested = 0;
+    std::atomic<int64_t> seeksElided = 0;
+    std::atomic<int64_t> startup[MarkCount] = {}; // us, steady clock. 0: not reached
+    std::atomic<int64_t> startTime = 0; // ms, media start time, frame timestamps are relative to it in PlayerStatus
+    PlayerStatus status;
+    std::atomic<bool> registered = true; // in the registry of MdkCallbacksRegisterPort(), false after unregistered
+};
+
+inline int64_t steadyTimeUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Updates PlayerStatus fields in its scope as a whole. Writers of mdk callbacks, texture plugins and workers are serialized, so the scope
+// must be short, e.g. no mdk calls inside
+class StatusWriter
+{
+public:
+    explicit StatusWriter(PlayerCounters& c) : s_(c.status) {
+        seq_ = s_.seq.load(std::memory_order_relaxed);
+        do {
+            while (seq_ & 1)
+                seq_ = s_.seq.load(std::memory_order_relaxed);
+        } while (!s_.seq.compare_exchange_weak(seq_, seq_ + 1, std::memory_order_acquire, std::memory_order_relaxed));
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    ~StatusWriter() { s_.seq.store(seq_ + 2, std::memory_order_release); }
+    StatusWriter(const StatusWriter&) = delete;
+    StatusWriter& operator=(const StatusWriter&) = delete;
+
+    PlayerStatus* operator->() const { return &s_; }
+
+private:
+    PlayerStatus& s_;
+    int64_t seq_;
+};
+
+// fields read by read(s) are from the same update
+template<class F>
+auto readStatus(const PlayerStatus& s, F&& read)
+{
+    while (true) {
+        const auto seq = s.seq.load(std::memory_order_acquire);
+        if (seq & 1)
+            continue;
+        auto v = read(s);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.seq.load(std::memory_order_relaxed) == seq)
+            return v;
+    }
+}
+
+// called by mdk frame callback on all platforms with timestamp of a video frame in seconds before it's delivered to renderers
+inline void statusFrame(PlayerCounters& c, double timestamp)
+{
+    if (timestamp < 0)
+        return;
+    const auto position = std::llround(timestamp * 1000.0) - c.startTime.load(std::memory_order_relaxed);
+    StatusWriter s(c);
+    s->position.store(position, std::memory_order_relaxed);
+}
+
+// called by texture plugins with the result of renderVideo(), i.e. timestamp of the rendered frame in seconds, < 0 if not rendered
+inline void statusRendered(PlayerCounters& c, double timestamp)
+{
+    if (timestamp < 0)
+        return;
+    const auto now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    StatusWriter s(c);
+    s->renderTime.store(now, std::memory_order_relaxed);
+}
+
+// start a new startup measurement, e.g. a new media
+inline void resetStartup(PlayerCounters& c)
+{
+    for (int i = MarkCount - 1; i > Prepare; --i)
+        c.startup[i].store(0, std::memory_order_relaxed);
+    c.startup[Prepare].store(steadyTimeUs(), std::memory_order_release);
+}
+
+// set the mark if not set since resetStartup(), and add the phase ends at the mark to the global histogram.
+// cheap if already set, so can be called for every frame. dropped if the player is unregistered, e.g. a late frame after dispose
+inline void markStartup(PlayerCounters& c, StartupMark mark)
+{
+    auto& t = c.startup[mark];
+    if (t.load(std::memory_order_relaxed) != 0 || !c.registered.load(std::memory_order_relaxed))
+        return;
+    const auto t0 = c.startup[Prepare].load(std::memory_order_acquire);
+    if (t0 == 0) // not started by MdkPrepare(), e.g. set(State::Playing) directly
+        return;
+    const auto now = steadyTimeUs();
+    int64_t expected = 0;
+    if (!t.compare_exchange_strong(expected, now, std::memory_order_relaxed))
+        return;
+    // marks can be reached out of order in different threads, e.g. a frame is rendered before the decoder event is delivered
+    auto from = t0;
+    for (int i = Prepare + 1; i < mark; ++i)
+        from = std::max(from, c.startup[i].load(std::memory_order_relaxed));
+    auto& h = startupHistogram();
+    h.add(mark - 1, std::max<int64_t>(now - from, 0));
+    if (mark == FirstPresent)
+        h.add(Total, now - t0);
+}
+
+// counters of a player handle created when the port is registered. never added to the registry, so a texture created after the port is
+// unregistered gets unregistered counters which are released with it. defined in callbacks.cpp
+std::shared_ptr<PlayerCounters> playerCounters(int64_t handle);
+// stop tracking the handle, references are still valid but unregistered
+void removePlayerCounters(int64_t handle);
+
+// accumulate count and duration of a scope into counters
+class ScopedTimer
+{
+public:
+    ScopedTimer(std::atomic<int64_t>& count, std::atomic<int64_t>& us)
+        : count_(count), us_(us), t0_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        count_.fetch_add(1, std::memory_order_relaxed);
+        us_.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0_).count(), std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t>& count_;
+    std::atomic<int64_t>& us_;
+    std::chrono::steady_clock::time_point t0_;
+};
+
+} // namespace fvp
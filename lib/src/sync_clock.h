@@ -0,0 +1,107 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// External master clock of a player, e.g. multi-screen sync. The master position is written into a seqlock slot by dart via a leaf ffi
+// call or by native code directly, and mdk sync callback reads it w/o locks and messages, extrapolated by rate and elapsed time.
+// Drift is the difference between a new master position and the position extrapolated from the previous one.
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+namespace fvp {
+
+class SyncClock
+{
+public:
+    static int64_t nowUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // set master position in seconds at timeUs(steady clock), rate 0 if paused. writers are serialized, readers never wait for a writer lock
+    void update(double position, double rate, int64_t timeUs = nowUs()) {
+        auto s = seq_.load(std::memory_order_relaxed);
+        do {
+            while (s & 1)
+                s = seq_.load(std::memory_order_relaxed);
+        } while (!seq_.compare_exchange_weak(s, s + 1, std::memory_order_acquire, std::memory_order_relaxed));
+        std::atomic_thread_fence(std::memory_order_release);
+        const auto t0 = time_.load(std::memory_order_relaxed);
+        if (t0 > 0) { // not the first one
+            const auto predicted = position_.load(std::memory_order_relaxed) + rate_.load(std::memory_order_relaxed) * (timeUs - t0) / 1e6;
+            const auto drift = int64_t(std::llround((position - predicted) * 1e6));
+            const auto a = std::abs(drift);
+            lastDriftUs_.store(drift, std::memory_order_relaxed);
+            if (a > maxDriftUs_.load(std::memory_order_relaxed))
+                maxDriftUs_.store(a, std::memory_order_relaxed);
+            driftSumUs_.fetch_add(a, std::memory_order_relaxed);
+            drifts_.fetch_add(1, std::memory_order_relaxed);
+        }
+        position_.store(position, std::memory_order_relaxed);
+        rate_.store(rate, std::memory_order_relaxed);
+        time_.store(timeUs, std::memory_order_relaxed);
+        seq_.store(s + 2, std::memory_order_release);
+        updates_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // master position in seconds at timeUs. paused at 0 until the first update()
+    double position(int64_t timeUs = nowUs()) {
+        double position, rate;
+        int64_t t0;
+        while (true) {
+            const auto s = seq_.load(std::memory_order_acquire);
+            if (!(s & 1)) {
+                position = position_.load(std::memory_order_relaxed);
+                rate = rate_.load(std::memory_order_relaxed);
+                t0 = time_.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (seq_.load(std::memory_order_relaxed) == s)
+                    break;
+            }
+            retries_.fetch_add(1, std::memory_order_relaxed);
+        }
+        reads_.fetch_add(1, std::memory_order_relaxed);
+        if (t0 == 0)
+            return position;
+        return position + rate * (timeUs - t0) / 1e6;
+    }
+
+    struct Stats {
+        int64_t updates;
+        int64_t reads;
+        int64_t retries;     // reads repeated because of a concurrent update()
+        int64_t lastDriftUs; // signed, master is ahead of the extrapolated position if > 0
+        int64_t maxDriftUs;  // abs
+        int64_t meanDriftUs; // abs
+    };
+
+    Stats stats() const {
+        const auto n = drifts_.load(std::memory_order_relaxed);
+        return {
+            .updates = updates_.load(std::memory_order_relaxed),
+            .reads = reads_.load(std::memory_order_relaxed),
+            .retries = retries_.load(std::memory_order_relaxed),
+            .lastDriftUs = lastDriftUs_.load(std::memory_order_relaxed),
+            .maxDriftUs = maxDriftUs_.load(std::memory_order_relaxed),
+            .meanDriftUs = n > 0 ? driftSumUs_.load(std::memory_order_relaxed) / n : 0,
+        };
+    }
+
+private:
+    std::atomic<uint32_t> seq_ = 0; // odd while writing
+    std::atomic<double> position_ = 0;
+    std::atomic<double> rate_ = 0;
+    std::atomic<int64_t> time_ = 0; // us, 0 if never updated
+    // written by update() only, in writer lock
+    std::atomic<int64_t> lastDriftUs_ = 0;
+    std::atomic<int64_t> maxDriftUs_ = 0;
+    std::atomic<int64_t> driftSumUs_ = 0;
+    std::atomic<int64_t> drifts_ = 0;
+    std::atomic<int64_t> updates_ = 0;
+    std::atomic<int64_t> reads_ = 0;
+    std::atomic<int64_t> retries_ = 0;
+};
+
+} // namespace fvp
@@ -0,0 +1,255 @@
+// Copyright 2026 Wang Bin. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Memory mapped binary trace ring. Writers append fixed header records from any thread w/o locks, the os writes pages back,
+// so records survive a crash and tracing can be always on. Decoded offline by readTrace(), see cmake/tools/trace_dump.cpp
+// A writer stalled while others wrap the whole ring can overwrite newer records, so the file should be much larger than logs of a lap
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string_view>
+#if defined(_WIN32)
+# ifndef NOMINMAX
+#  define NOMINMAX
+# endif
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <pthread.h>
+# include <sys/mman.h>
+# include <unistd.h>
+# if defined(__linux__)
+#  include <sys/syscall.h>
+# endif
+#endif
+
+namespace fvp {
+
+static_assert(std::endian::native == std::endian::little, "trace files are little endian");
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+enum class TraceKind : uint16_t {
+    Padding,     // fills the end of record area before wrapping
+    Log,         // level, text
+    Event,       // values[0]: error, text: category '\0' detail
+    State,       // values: old, new
+    MediaStatus, // values: old, new
+};
+
+struct TraceFileHeader {
+    char magic[8];      // "FVPTRACE"
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t capacity;  // bytes of record area after header
+    uint64_t write;     // bytes reserved since created. record area position is write % capacity
+    int64_t startTime;  // us since epoch
+    uint8_t reserved[24];
+};
+static_assert(sizeof(TraceFileHeader) == 64);
+
+// 8 bytes aligned, followed by text
+struct TraceRecord {
+    uint64_t offset;    // write counter when reserved, stored last to commit the record. a record is valid only if offset matches its position
+    uint32_t size;      // including header and padded text
+    uint16_t kind;      // TraceKind
+    uint16_t level;     // mdk::LogLevel
+    int64_t time;       // us since epoch
+    int64_t player;     // player handle, 0 for global
+    int64_t values[2];
+    uint32_t tid;       // os thread id
+    uint32_t textSize;
+};
+static_assert(sizeof(TraceRecord) == 56);
+
+inline uint32_t currentThreadId()
+{
+#if defined(_WIN32)
+    return GetCurrentThreadId();
+#elif defined(__APPLE__)
+    uint64_t tid = 0;
+    pthread_threadid_np(nullptr, &tid);
+    return (uint32_t)tid;
+#elif defined(__linux__)
+    return (uint32_t)syscall(SYS_gettid);
+#else
+    return (uint32_t)(uintptr_t)pthread_self();
+#endif
+}
+
+inline int64_t traceTimeUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+class TraceFile
+{
+public:
+    static constexpr uint32_t kMaxText = 4000;
+
+    // create or truncate path to size bytes and map it. return null if failed
+    static std::unique_ptr<TraceFile> create(const char* path, int64_t size) {
+        size = std::max<int64_t>(size, 64 << 10) & ~int64_t(7);
+        std::unique_ptr<TraceFile> t(new TraceFile());
+#if defined(_WIN32)
+        t->file_ = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (t->file_ == INVALID_HANDLE_VALUE)
+            return {};
+        t->mapping_ = CreateFileMappingA(t->file_, nullptr, PAGE_READWRITE, DWORD(size >> 32), DWORD(size), nullptr);
+        if (!t->mapping_)
+            return {};
+        t->data_ = static_cast<uint8_t*>(MapViewOfFile(t->mapping_, FILE_MAP_ALL_ACCESS, 0, 0, size));
+        if (!t->data_)
+            return {};
+#else
+        t->fd_ = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (t->fd_ < 0 || ftruncate(t->fd_, size) != 0)
+            return {};
+        auto p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, t->fd_, 0);
+        if (p == MAP_FAILED)
+            return {};
+        t->data_ = static_cast<uint8_t*>(p);
+#endif
+        t->size_ = size;
+        auto h = t->header();
+        memcpy(h->magic, "FVPTRACE", 8);
+        h->version = 1;
+        h->headerSize = sizeof(TraceFileHeader);
+        h->capacity = size - sizeof(TraceFileHeader);
+        h->startTime = traceTimeUs();
+        return t;
+    }
+
+    ~TraceFile() {
+#if defined(_WIN32)
+        if (data_) {
+            FlushViewOfFile(data_, 0);
+            UnmapViewOfFile(data_);
+        }
+        if (mapping_)
+            CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE)
+            CloseHandle(file_);
+#else
+        if (data_)
+            munmap(data_, size_);
+        if (fd_ >= 0)
+            close(fd_);
+#endif
+    }
+
+    // text2 is appended after a '\0' if not empty. text is truncated to kMaxText
+    void append(TraceKind kind, int level, int64_t player, int64_t v0, int64_t v1, std::string_view text = {}, std::string_view text2 = {}) {
+        const auto n1 = std::min<size_t>(text.size(), kMaxText);
+        const auto n2 = text2.empty() ? 0 : std::min<size_t>(text2.size() + 1, kMaxText - n1);
+        const auto textSize = uint32_t(n1 + n2);
+        const auto size = uint32_t((sizeof(TraceRecord) + textSize + 7) & ~size_t(7));
+        const auto capacity = header()->capacity;
+        auto& write = counter();
+        auto w = write.load(std::memory_order_relaxed);
+        uint64_t need = 0;
+        do {
+            const auto pos = w % capacity;
+            need = pos + size > capacity ? capacity - pos + size : size;
+        } while (!write.compare_exchange_weak(w, w + need, std::memory_order_relaxed));
+        if (need != size) {
+            const auto pos = w % capacity;
+            if (capacity - pos >= sizeof(TraceRecord)) { // otherwise readers know it's the end
+                auto pad = record(pos);
+                pad->size = uint32_t(capacity - pos);
+                pad->kind = (uint16_t)TraceKind::Padding;
+                commit(pad, w);
+            }
+            w += need - size;
+        }
+        auto r = record(w % capacity);
+        r->size = size;
+        r->kind = (uint16_t)kind;
+        r->level = (uint16_t)level;
+        r->time = traceTimeUs();
+        r->player = player;
+        r->values[0] = v0;
+        r->values[1] = v1;
+        r->tid = currentThreadId();
+        r->textSize = textSize;
+        auto s = reinterpret_cast<char*>(r + 1);
+        memcpy(s, text.data(), n1);
+        if (n2 > 0) {
+            s[n1] = 0;
+            memcpy(s + n1 + 1, text2.data(), n2 - 1);
+        }
+        commit(r, w);
+    }
+
+private:
+    TraceFile() = default;
+    TraceFileHeader* header() const { return reinterpret_cast<TraceFileHeader*>(data_); }
+    std::atomic<uint64_t>& counter() const { return *reinterpret_cast<std::atomic<uint64_t>*>(&header()->write); }
+    TraceRecord* record(uint64_t pos) const { return reinterpret_cast<TraceRecord*>(data_ + sizeof(TraceFileHeader) + pos); }
+    static void commit(TraceRecord* r, uint64_t offset) {
+        reinterpret_cast<std::atomic<uint64_t>*>(&r->offset)->store(offset, std::memory_order_release);
+    }
+
+    uint8_t* data_ = nullptr;
+    int64_t size_ = 0;
+#if defined(_WIN32)
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+// visit committed records of a trace file from oldest to newest. data is the whole file. return false if not a trace file.
+// if the ring wrapped, the oldest record is found by scanning for a record whose offset matches its position. the same scan skips
+// records torn by a writer preempted for a whole lap, and records reserved but not committed
+inline bool readTrace(const uint8_t* data, size_t size, const std::function<void(const TraceRecord&, std::string_view text)>& visit)
+{
+    if (size < sizeof(TraceFileHeader))
+        return false;
+    TraceFileHeader h;
+    memcpy(&h, data, sizeof(h));
+    if (memcmp(h.magic, "FVPTRACE", 8) != 0 || h.version != 1 || h.headerSize < sizeof(h) || h.capacity == 0 || h.headerSize + h.capacity > size)
+        return false;
+    const auto records = data + h.headerSize;
+    const auto cap = h.capacity;
+    const auto end = h.write % cap;
+    const auto base = h.write - end; // write counter at position 0 of current lap
+    // return record size if valid at pos, 0 if not a record, or the end of lap
+    const auto valid = [&](uint64_t pos, uint64_t lapBase, TraceRecord& r) -> uint64_t {
+        if (cap - pos < sizeof(TraceRecord))
+            return 0;
+        memcpy(&r, records + pos, sizeof(r));
+        if (r.offset != lapBase + pos || r.size < sizeof(TraceRecord) || r.size % 8 || pos + r.size > cap || r.kind > (uint16_t)TraceKind::MediaStatus)
+            return 0;
+        if (r.kind != (uint16_t)TraceKind::Padding && sizeof(TraceRecord) + r.textSize > r.size)
+            return 0;
+        return r.size;
+    };
+    const auto walk = [&](uint64_t pos, uint64_t stop, uint64_t lapBase) {
+        TraceRecord r;
+        while (pos < stop) {
+            const auto n = valid(pos, lapBase, r);
+            if (!n) {
+                pos += 8;
+                continue;
+            }
+            if (r.kind == (uint16_t)TraceKind::Padding)
+                return;
+            visit(r, std::string_view(reinterpret_cast<const char*>(records + pos + sizeof(r)), r.textSize));
+            pos += n;
+        }
+    };
+    if (base >= cap) // previous lap in [end, cap)
+        walk((end + 7) & ~uint64_t(7), cap, base - cap);
+    walk(0, end, base);
+    return true;
+}
+
+} // namespace fvp
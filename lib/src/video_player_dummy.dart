@@ -23,7 +23,8 @@ class MdkVideoPlayerPlatform {
 
   void record(int playerId, {String? to, String? format}) {}
 
-  Future<Uint8List?> snapshot(int playerId, {int? width, int? height}) async {
+  Future<Uint8List?> snapshot(int playerId,
+      {int? width, int? height, String? format, int quality = -1}) async {
     return null;
   }
 
@@ -120,6 +120,7 @@ class MdkVideoPlayerPlatform extends VideoPlayerPlatform {
   static bool? _tunnel;
   static String? _subtitleFontFile;
   static int _lowLatency = 0;
+  static int _logBatchInterval = 0;
   static int _seekFlags = mdk.SeekFlag.fromStart | mdk.SeekFlag.inCache;
   static List<String>? _decoders;
   static final _mdkLog = Logger('mdk');
@@ -154,6 +155,7 @@ class MdkVideoPlayerPlatform extends VideoPlayerPlatform {
         _seekFlags |= mdk.SeekFlag.keyFrame;
       }
       _lowLatency = (options['lowLatency'] ?? 0) as int;
+      _logBatchInterval = (options['logBatchInterval'] ?? 0) as int;
       _maxWidth = options["maxWidth"];
       _maxHeight = options["maxHeight"];
       _fitMaxSize = options["fitMaxSize"];
@@ -223,6 +225,11 @@ class MdkVideoPlayerPlatform extends VideoPlayerPlatform {
           return;
       }
     });
+    if (_logBatchInterval > 0) {
+      // all logs are generated, deliver them in batches to keep ui isolate responsive
+      mdk.setLogForwarding(
+          interval: Duration(milliseconds: _logBatchInterval));
+    }
     // mdk.setGlobalOptions('plugins', 'mdk-braw');
     mdk.setGlobalOption("log", "all");
     mdk.setGlobalOption('d3d11.sync.cpu', 1);
@@ -557,8 +564,10 @@ class MdkVideoPlayerPlatform extends VideoPlayerPlatform {
     _players[playerId]?.record(to: to, format: format);
   }
 
-  Future<Uint8List?> snapshot(int playerId, {int? width, int? height}) async {
-    return _players[playerId]?.snapshot(width: width, height: height);
+  Future<Uint8List?> snapshot(int playerId,
+      {int? width, int? height, String? format, int quality = -1}) async {
+    return _players[playerId]
+        ?.snapshot(width: width, height: height, format: format, quality: quality);
   }
 
   void setRange(int playerId, {required int from, int to = -1}) {
@@ -6,6 +6,7 @@
 #include "include/fvp/fvp_plugin.h"
 
 #include <algorithm>
+#include <atomic>
 #include <flutter_linux/flutter_linux.h>
 #include <gtk/gtk.h>
 #include <gdk/gdkx.h>
@@ -23,6 +24,10 @@
 
 #include "mdk/RenderAPI.h"
 #include "mdk/Player.h"
+#include "../lib/src/registry.h"
+#include "../lib/src/render_target_pool.h"
+#include "../lib/src/spans.h"
+#include "../lib/src/stats.h"
 
 using namespace std;
 
@@ -56,12 +61,24 @@ private:
 };
 static thread_local list<shared_ptr<CleanupTask>> gCleanupTasks;
 
+// fbo and texture of a player texture, recycled by the pool of gl context after the texture is disposed. fenced when released because
+// composition may still sample it
+struct RenderTargets {
+  GLuint fbo;
+  GLuint texture_id;
+  GLsync fence;
+  int width; // allocated size
+  int height;
+};
+using RenderTargetPool = fvp::RenderTargetPool<RenderTargets*>;
+
 struct _PlayerTexture {
   FlTextureGL parent_instance;
 
   GdkGLContext* ctx;
-  GLuint texture_id;
-  GLuint fbo;
+  RenderTargets* rt; // owned by cleanup task
+  uint64_t rendered; // frame sequence rendered into rt
+  bool first_presented;
 
   TexturePlayer* player;
   CleanupTask* cleanup;
@@ -74,8 +91,9 @@ class TexturePlayer final : public mdk::Player
 public:
   TexturePlayer(int64_t handle, PlayerTexture* tex, int w, int h, FlTextureRegistrar* texRegistrar)
     : mdk::Player(reinterpret_cast<mdkPlayerAPI*>(handle))
-    , width(w)
-    , height(h)
+    , handle(handle)
+    , stats(fvp::playerCounters(handle))
+    , size(pack(w, h))
     , texReg(texRegistrar)
     , flTex(tex)
   {
@@ -88,9 +106,10 @@ public:
     textureId = fl_texture_get_id(FL_TEXTURE(flTex)); // MUST be after fl_texture_registrar_register_texture(), id is set there
 
     scale(1, -1); // y is flipped
-    setVideoSurfaceSize(width, height);
+    setVideoSurfaceSize(w, h);
     setRenderCallback([this](void*) {
       //renderVideo(); // need a gl context
+      ++frameSeq;
       fl_texture_registrar_mark_texture_frame_available(texReg, FL_TEXTURE(flTex));
       });
   }
@@ -105,14 +124,128 @@ public:
     g_object_unref(flTex);
   }
 
+  // storage is reallocated in the next populate() in raster thread, texture id is not changed
+  void resize(int w, int h) {
+    size = pack(w, h);
+    redraw();
+  }
+
+  // populate() again w/o a new frame
+  void redraw() {
+    fl_texture_registrar_mark_texture_frame_available(texReg, FL_TEXTURE(flTex));
+  }
+
+  // requested size
+  pair<int, int> requestedSize() const {
+    const uint64_t v = size;
+    return {int(v >> 32), int(v & 0xffffffff)};
+  }
+
   int64_t textureId;
-  int width;
-  int height;
+  const int64_t handle;
+  const int64_t created = fvp::SpanRecorder::now();
+  const shared_ptr<fvp::PlayerCounters> stats;
+  atomic<uint64_t> frameSeq = 1; // increased when mdk requests a redraw, e.g. a new frame is decoded. 0 is never rendered
 private:
+  static uint64_t pack(int w, int h) { return (uint64_t(uint32_t(w)) << 32) | uint32_t(h); }
+
+  atomic<uint64_t> size;
   FlTextureRegistrar* texReg;
   PlayerTexture* flTex; // hold ref
 };
 
+// block until commands before the fence are done, e.g. composition of the texture which owned recycled targets. the fence is deleted even
+// if timed out, commands are in the same context, so the order is still correct
+static void fence_wait(GLsync& fence) {
+  if (!fence)
+    return;
+  glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000); // 100ms
+  glDeleteSync(fence);
+  fence = nullptr;
+}
+
+static void delete_targets(RenderTargets*& rt) {
+  clog << "delete fbo: " + std::to_string(rt->fbo) + " tex: " + std::to_string(rt->texture_id) << endl;
+  glDeleteTextures(1, &rt->texture_id);
+  glDeleteFramebuffers(1, &rt->fbo);
+  if (rt->fence)
+    glDeleteSync(rt->fence);
+  delete rt;
+  rt = nullptr;
+}
+
+static RenderTargetPool& target_pool(GdkGLContext* ctx) {
+  return RenderTargetPool::of(ctx, delete_targets);
+}
+
+// render targets are released to the pool when the texture is disposed
+static void add_cleanup(PlayerTexture* self) {
+  auto task = make_shared<CleanupTask>(self->ctx, [rt = self->rt, ctx = self->ctx]() {
+    if (rt->fence)
+      glDeleteSync(rt->fence);
+    rt->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    target_pool(ctx).release(rt->width, rt->height, int64_t(rt->width) * rt->height * 4, rt);
+  });
+  self->cleanup = task.get();
+  gCleanupTasks.push_back(std::move(task));
+}
+
+static void set_render_api(PlayerTexture* self) {
+  mdk::GLRenderAPI ra{};
+  ra.fbo = self->rt->fbo;
+  self->player->setRenderAPI(&ra);
+}
+
+static bool create_targets(PlayerTexture* self) {
+  self->ctx = gdk_gl_context_get_current(); // fbo can not be shared
+  const auto [w, h] = self->player->requestedSize();
+  if (auto rt = target_pool(self->ctx).acquire(w, h)) {
+    fvp::ScopedSpan span("reuse render targets", self->player->handle);
+    self->rt = *rt;
+    fence_wait(self->rt->fence);
+    add_cleanup(self);
+    set_render_api(self);
+    return true;
+  }
+  fvp::ScopedSpan span("create render targets", self->player->handle);
+  self->rt = new RenderTargets{};
+  self->rt->width = w;
+  self->rt->height = h;
+  GLint prevFbo = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFbo);
+  glGenFramebuffers(1, &self->rt->fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, self->rt->fbo);
+  glGenTextures(1, &self->rt->texture_id);
+  clog << "created fbo: " + std::to_string(self->rt->fbo) + " tex: " + std::to_string(self->rt->texture_id) + " in raster thread " << this_thread::get_id() << endl;
+  glBindTexture(GL_TEXTURE_2D, self->rt->texture_id);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + 0, GL_TEXTURE_2D, self->rt->texture_id, 0);
+  const GLenum err = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, prevFbo);
+  if (err != GL_FRAMEBUFFER_COMPLETE) {
+    clog << "glFramebufferTexture2D error" << endl;
+    auto task = make_shared<CleanupTask>(self->ctx, [rt = self->rt]() mutable { delete_targets(rt); }); // not recycled
+    self->cleanup = task.get();
+    gCleanupTasks.push_back(std::move(task));
+    return false;
+  }
+  add_cleanup(self);
+  set_render_api(self);
+  return true;
+}
+
+// reallocate texture storage, fbo and texture are kept. the current frame is rendered again in new size, so no black frame
+static void resize_targets(PlayerTexture* self, int w, int h) {
+  fvp::ScopedSpan span("resize render targets", self->player->handle);
+  clog << "resize render targets from " << self->rt->width << "x" << self->rt->height << " to " << w << "x" << h << endl;
+  glBindTexture(GL_TEXTURE_2D, self->rt->texture_id);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  self->rt->width = w;
+  self->rt->height = h;
+  self->rendered = 0;
+  self->player->setVideoSurfaceSize(w, h);
+}
+
 // called in a current gl context
 static gboolean player_texture_populate(FlTextureGL *texture, uint32_t *target, uint32_t *name,
                         uint32_t *width, uint32_t *height, GError **error) {
@@ -121,45 +254,38 @@ static gboolean player_texture_populate(FlTextureGL *texture, uint32_t *target,
     clog << std::to_string(count) + " cleanup tasks executed in raster thread " << this_thread::get_id() << endl;
   }
   PlayerTexture *self = PLAYER_TEXTURE(texture);
-
-  if (self->fbo == 0) {
-    self->ctx = gdk_gl_context_get_current(); // fbo can not be shared
-    glGenFramebuffers(1, &self->fbo);
-    assert(self->texture_id == 0);
-    GLint prevFbo = 0;
-    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, self->fbo);
-    glGenTextures(1, &self->texture_id);
-    clog << "created fbo: " + std::to_string(self->fbo) + " tex: " + std::to_string(self->texture_id) + " in raster thread " << this_thread::get_id() << endl;
-    auto task = make_shared<CleanupTask>(self->ctx, [tex = self->texture_id, fbo = self->fbo]() {
-      clog << "delete fbo: " + std::to_string(fbo) + " tex: " + std::to_string(tex) << endl;
-      glDeleteTextures(1, &tex);
-      glDeleteFramebuffers(1, &fbo);
-    });
-    self->cleanup = task.get();
-    gCleanupTasks.push_back(std::move(task));
-
-    glBindTexture(GL_TEXTURE_2D, self->texture_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, self->player->width, self->player->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + 0, GL_TEXTURE_2D, self->texture_id, 0);
-    const GLenum err = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-    glBindFramebuffer(GL_FRAMEBUFFER, prevFbo);
-    if (err != GL_FRAMEBUFFER_COMPLETE) {
-        //glDeleteFramebuffers(1, &fbo);
-        clog << "glFramebufferTexture2D error" << endl;
-        return FALSE;
+  fvp::ScopedSpan span("populate", self->player->handle);
+
+  if (!self->rt && !create_targets(self))
+    return FALSE;
+  if (const auto [w, h] = self->player->requestedSize(); w != self->rt->width || h != self->rt->height)
+    resize_targets(self, w, h);
+
+  // flutter repaints for other reasons, reuse the rendered texture if no new frame
+  if (const uint64_t seq = self->player->frameSeq; seq != self->rendered) {
+    double timestamp = -1;
+    {
+      fvp::ScopedSpan span("renderVideo", self->player->handle);
+      fvp::ScopedTimer t(self->player->stats->renderCalls, self->player->stats->renderUs);
+      timestamp = self->player->renderVideo();
     }
-    mdk::GLRenderAPI ra{};
-    ra.fbo = self->fbo;
-    self->player->setRenderAPI(&ra);
+    fvp::statusRendered(*self->player->stats, timestamp);
+    fvp::markStartup(*self->player->stats, fvp::FirstRender);
+    self->rendered = seq;
+    self->player->stats->framesPresented++;
+  } else {
+    self->player->stats->renderSkipped++;
+  }
+  fvp::markStartup(*self->player->stats, fvp::FirstPresent);
+  if (!self->first_presented) {
+    self->first_presented = true;
+    fvp::SpanRecorder::instance().record("first frame", self->player->handle, self->player->created, fvp::SpanRecorder::now());
   }
-
-  self->player->renderVideo();
 
   *target = GL_TEXTURE_2D;
-  *name = self->texture_id;
-  *width = self->player->width;
-  *height = self->player->height;
+  *name = self->rt->texture_id;
+  *width = self->rt->width;
+  *height = self->rt->height;
 
   return TRUE;
 }
@@ -167,7 +293,7 @@ static gboolean player_texture_populate(FlTextureGL *texture, uint32_t *target,
 static void player_texture_dispose(GObject* obj) {
   G_OBJECT_CLASS(player_texture_parent_class)->dispose(obj);
   auto self = PLAYER_TEXTURE(obj);
-  if (!self->texture_id && !self->fbo) {
+  if (!self->rt) {
     clog << "texture and fbo are not created yet" << endl;
     return;
   }
@@ -187,8 +313,9 @@ static void player_texture_class_init(PlayerTextureClass* klass) {
 }
 
 static void player_texture_init(PlayerTexture* self) {
-  self->texture_id = 0;
-  self->fbo = 0;
+  self->rt = nullptr;
+  self->rendered = 0;
+  self->first_presented = false;
   self->player = nullptr;
   self->ctx = nullptr;
   self->cleanup = nullptr;
@@ -199,7 +326,7 @@ static void player_texture_init(PlayerTexture* self) {
   (G_TYPE_CHECK_INSTANCE_CAST((obj), fvp_plugin_get_type(), \
                               FvpPlugin))
 
-using PlayerMap = unordered_map<int64_t, shared_ptr<TexturePlayer>>;
+using PlayerMap = fvp::Registry<TexturePlayer>;
 struct _FvpPlugin {
   GObject parent_instance;
 
@@ -223,19 +350,28 @@ static void fvp_plugin_handle_method_call(
     const auto handle = fl_value_get_int(fl_value_lookup_string(args, "player"));
     const auto width = (int)fl_value_get_int(fl_value_lookup_string(args, "width"));
     const auto height = (int)fl_value_get_int(fl_value_lookup_string(args, "height"));
+    fvp::ScopedSpan span("CreateRT", handle);
     auto tex = PLAYER_TEXTURE(g_object_new(player_texture_get_type(), nullptr));
     auto player = make_shared<TexturePlayer>(handle, tex, width, height, self->tex_registrar);
-    self->players[player->textureId] = player;
+    self->players.set(player->textureId, player);
     g_autoptr(FlValue) result = fl_value_new_int(player->textureId);
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
   } else if (strcmp(method, "ReleaseRT") == 0) {
     const auto args = fl_method_call_get_args(method_call);
     const auto texId = fl_value_get_int(fl_value_lookup_string(args, "texture"));
-    if (auto it = self->players.find(texId); it != self->players.cend()) {
-        self->players.erase(it);
-    }
+    self->players.erase(texId);
     g_autoptr(FlValue) result = fl_value_new_null();
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (strcmp(method, "ResizeRT") == 0) {
+    const auto args = fl_method_call_get_args(method_call);
+    const auto texId = fl_value_get_int(fl_value_lookup_string(args, "texture"));
+    const auto width = (int)fl_value_get_int(fl_value_lookup_string(args, "width"));
+    const auto height = (int)fl_value_get_int(fl_value_lookup_string(args, "height"));
+    auto player = self->players.get(texId);
+    if (player)
+      player->resize(width, height);
+    g_autoptr(FlValue) result = fl_value_new_bool(!!player);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
   } else if (strcmp(method, "MixWithOthers") == 0) {
     g_autoptr(FlValue) result = fl_value_new_null();
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
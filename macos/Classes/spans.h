@@ -0,0 +1 @@
+../../lib/src/spans.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../lib/src/stats.h
\ No newline at end of file
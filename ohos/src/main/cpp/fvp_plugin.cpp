@@ -9,7 +9,7 @@
 #include <rawfile/raw_file_manager.h>
 #include <mdk/Player.h>
 #include <iostream>
-#include <unordered_map>
+#include "../../../../lib/src/registry.h"
 
 using namespace std;
 
@@ -24,7 +24,7 @@ public:
     OHNativeWindow* window = nullptr;
 };
 
-static unordered_map<int64_t, shared_ptr<TexturePlayer>> players;
+static fvp::Registry<TexturePlayer> players;
 
 // nativeSetSurface(playerHandle: number, texId: number, surfaceId: number, w: number, h: number): void
 static napi_value NativeSetSurface(napi_env env, napi_callback_info info)
@@ -47,14 +47,12 @@ static napi_value NativeSetSurface(napi_env env, napi_callback_info info)
     napi_get_value_int32(env, args[4], &h);
 
     if (!playerHandle || !surfaceId) {
-        if (auto it = players.find(texId); it != players.end()) {
-            auto& player = it->second;
+        if (auto player = players.take(texId)) {
             player->updateNativeSurface(nullptr);
             if (player->window) {
                 OH_NativeWindow_DestroyNativeWindow(player->window);
                 player->window = nullptr;
             }
-            players.erase(it);
         } else {
             clog << "FvpPlugin: player not found (already removed?) for texId " << texId << endl;
         }
@@ -74,7 +72,7 @@ static napi_value NativeSetSurface(napi_env env, napi_callback_info info)
 
     player->window = window;
     player->updateNativeSurface(window, w, h);
-    players[texId] = player;
+    players.set(texId, player);
 
     return nullptr;
 }
@@ -116,8 +114,8 @@ extern "C" void* MdkGetPlayerVid(int64_t tex_id)
 {
     if (tex_id < 0)
         return nullptr;
-    if (const auto it = players.find(tex_id); it != players.end()) {
-        return it->second->window;
+    if (const auto player = players.get(tex_id)) {
+        return player->window;
     }
     return nullptr;
 }
@@ -5,6 +5,7 @@
 // found in the LICENSE file.
 #include "fvp_plugin.h"
 #include <flutter/standard_method_codec.h>
+#include "../lib/src/stats.h"
 
 #pragma comment(lib, "dxgi.lib")
 #pragma comment(lib, "d3d11.lib")
@@ -30,6 +31,7 @@ class TexturePlayer final: public Player
 public:
     TexturePlayer(int64_t handle, const ComPtr<ID3D11Texture2D>& d3d11tex, flutter::TextureRegistrar* texRegistrar)
         : Player(reinterpret_cast<mdkPlayerAPI*>(handle))
+        , stats(fvp::playerCounters(handle))
         , rt(d3d11tex)
     {
         ComPtr<ID3D11Device> dev;
@@ -62,6 +64,8 @@ public:
                 scoped_lock lock(mtx);
                 ctx->CopyResource(tex.Get(), rt.Get());
                 ctx->Flush();
+                if (stats->startup[fvp::FirstRender].load(memory_order_relaxed)) // otherwise nothing is rendered
+                    fvp::markStartup(*stats, fvp::FirstPresent);
                 return pflt_surface_desc;
             }));
         textureId = texRegistrar->RegisterTexture(flt_tex.get());
@@ -73,7 +77,14 @@ public:
         setVideoSurfaceSize(desc.Width, desc.Height);
         setRenderCallback([this, texRegistrar](void*) {
             scoped_lock lock(mtx);
-            renderVideo();
+            double timestamp = -1;
+            {
+                fvp::ScopedTimer t(stats->renderCalls, stats->renderUs);
+                timestamp = renderVideo();
+            }
+            fvp::statusRendered(*stats, timestamp);
+            fvp::markStartup(*stats, fvp::FirstRender);
+            stats->framesPresented++;
             texRegistrar->MarkTextureFrameAvailable(textureId);
             });
 
@@ -87,6 +98,7 @@ public:
     int64_t textureId;
 
 private:
+    const shared_ptr<fvp::PlayerCounters> stats;
     unique_ptr<flutter::TextureVariant> flt_tex;
     unique_ptr<FlutterDesktopGpuSurfaceDescriptor> flt_surface_desc = make_unique<FlutterDesktopGpuSurfaceDescriptor>();
     ComPtr<ID3D11Texture2D> tex;